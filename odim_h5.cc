@@ -18,11 +18,46 @@
 #include "odim_h5.h"
 
 #include <hdf5.h>
+#include <hdf5_hl.h>
 #include <malloc.h>
+#include <zlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <time.h>
 
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
 using namespace odim_h5;
 
 #define timegm _mkgmtime
@@ -77,7 +112,6 @@ static const char* what_names[] =
   , "time"
   , "undetect"
   , "version"
-  , nullptr
 };
 
 /* Note:
@@ -115,30 +149,28 @@ static const char* where_names[] =
   , "start_lat"
   , "start_lon"
   , "startaz"
-  , "stop_lon"
   , "stop_lat"
+  , "stop_lon"
   , "stopaz"
   , "xscale"
   , "xsize"
   , "yscale"
   , "ysize"
-  , nullptr
 };
 
+static auto name_less(const char* lhs, const char* rhs) -> bool
+{
+  return strcmp(lhs, rhs) < 0;
+}
+
 static auto is_what_attribute(const char* name) -> bool
 {
-  for (auto ptr = what_names; *ptr != nullptr; ++ptr)
-    if (strcmp(*ptr, name) == 0)
-      return true;
-  return false;
+  return std::binary_search(std::begin(what_names), std::end(what_names), name, name_less);
 }
 
 static auto is_where_attribute(const char* name) -> bool
 {
-  for (auto ptr = where_names; *ptr != nullptr; ++ptr)
-    if (strcmp(*ptr, name) == 0)
-      return true;
-  return false;
+  return std::binary_search(std::begin(where_names), std::end(where_names), name, name_less);
 }
 
 static auto make_error(
@@ -229,1039 +261,4294 @@ static auto hdf_storage_type(data::data_type type) -> hid_t
   }
 }
 
-static auto strings_to_time(const std::string& date, const std::string& time) -> time_t
-{
-  struct tm tms;
-  if (   sscanf_s(date.c_str(), "%04d%02d%02d", &tms.tm_year, &tms.tm_mon, &tms.tm_mday) != 3
-      || sscanf_s(time.c_str(), "%02d%02d%02d", &tms.tm_hour, &tms.tm_min, &tms.tm_sec) != 3)
-    throw make_error({}, "date/time syntax error");
-  tms.tm_year -= 1900;
-  tms.tm_mon -= 1;
-  tms.tm_wday = 0;
-  tms.tm_yday = 0;
-  tms.tm_isdst = 0;
-  return timegm(&tms);
-}
+// size of the buffer (in bytes) used to stream packed data into a layer
+static constexpr size_t stream_block_size = 256 * 1024;
 
-static auto time_to_strings(time_t val, char date[9], char time[7]) -> void
-{
-  struct tm tms;
-  //gmtime_r(&val, &tms);
-  gmtime_s(&tms, &val);
-  snprintf(date, 9, "%04d%02d%02d", tms.tm_year + 1900, tms.tm_mon + 1, tms.tm_mday);
-  snprintf(time, 7, "%02d%02d%02d", tms.tm_hour, tms.tm_min, tms.tm_sec);
-}
+// layers no larger than this (in bytes) are stored compact by the automatic layout policy
+static constexpr size_t auto_compact_limit = 16 * 1024;
 
-//------------------------------------------------------------------------------
+// target chunk size (in bytes) used by the automatic layout policy
+static constexpr size_t auto_chunk_size = 256 * 1024;
 
-auto odim_h5::release_tag() -> char const*
+// registered HDF5 filter identifiers of the optional codecs
+static constexpr H5Z_filter_t filter_lz4 = 32004;
+static constexpr H5Z_filter_t filter_zstd = 32015;
+
+static auto codec_filter(data::compression_options::codec type) -> H5Z_filter_t
 {
-	//return ODIM_H5_RELEASE_TAG;
-	return "1.4.0"; // TODO do this properly later, just sidestepping learning cmake 
+  switch (type)
+  {
+  case data::compression_options::codec::deflate:
+    return H5Z_FILTER_DEFLATE;
+  case data::compression_options::codec::lz4:
+    return filter_lz4;
+  case data::compression_options::codec::zstd:
+    return filter_zstd;
+  default:
+    return H5Z_FILTER_NONE;
+  }
 }
 
-auto odim_h5::default_odim_version() -> std::pair<int, int>
+// check whether a filter is registered and able to encode
+static auto filter_encode_available(H5Z_filter_t filter) -> bool
 {
-  return {default_version_major, default_version_minor};
+  unsigned int config = 0;
+  return    filter != H5Z_FILTER_NONE
+         && H5Zfilter_avail(filter) > 0
+         && H5Zget_filter_info(filter, &config) >= 0
+         && (config & H5Z_FILTER_CONFIG_ENCODE_ENABLED);
 }
 
-handle::handle(const handle& rhs)
-  : id{rhs.id}
+// add the compression filter pipeline to a dataset creation property list
+static auto set_compression(const handle& hnd, hid_t plist, const data::compression_options& opts) -> void
 {
-  if (id > 0)
-    H5Iinc_ref(id);
+  using codec = data::compression_options::codec;
+  if (opts.type() == codec::none)
+    return;
+
+  if (opts.shuffle() && H5Pset_shuffle(plist) < 0)
+    throw make_error(hnd, "create dataset", nullptr, "failed to set shuffle filter");
+
+  herr_t err;
+  auto type = opts.type();
+  if (type != codec::deflate && !filter_encode_available(codec_filter(type)))
+    err = H5Pset_deflate(plist, data::default_compression);
+  else if (type == codec::lz4)
+    err = H5Pset_filter(plist, filter_lz4, H5Z_FLAG_OPTIONAL, 0, nullptr);
+  else if (type == codec::zstd)
+  {
+    const unsigned int values[1] = { static_cast<unsigned int>(opts.level()) };
+    err = H5Pset_filter(plist, filter_zstd, H5Z_FLAG_OPTIONAL, 1, values);
+  }
+  else
+    err = H5Pset_deflate(plist, opts.level());
+  if (err < 0)
+    throw make_error(hnd, "create dataset", nullptr, "failed to set compression filter");
 }
 
-auto handle::operator=(const handle& rhs) -> handle&
+static auto storage_type_size(data::data_type type) -> size_t
 {
-  if (id == rhs.id)
-    return *this;
-  if (id > 0)
-    H5Idec_ref(id);
-  id = rhs.id;
-  if (id > 0)
-    H5Iinc_ref(id);
-  return *this;
+  switch (type)
+  {
+  case data::data_type::i8:
+  case data::data_type::u8:
+    return 1;
+  case data::data_type::i16:
+  case data::data_type::u16:
+    return 2;
+  case data::data_type::i32:
+  case data::data_type::u32:
+  case data::data_type::f32:
+    return 4;
+  case data::data_type::i64:
+  case data::data_type::u64:
+  case data::data_type::f64:
+    return 8;
+  default:
+    return 0;
+  }
 }
 
-handle::~handle()
+// memory type used to read or write a storage type without conversion
+static auto hdf_memory_type(data::data_type type) -> hid_t
 {
-  if (id > 0)
-    H5Idec_ref(id);
+  switch (type)
+  {
+  case data::data_type::i8:
+    return H5T_NATIVE_INT8;
+  case data::data_type::u8:
+    return H5T_NATIVE_UINT8;
+  case data::data_type::i16:
+    return H5T_NATIVE_INT16;
+  case data::data_type::u16:
+    return H5T_NATIVE_UINT16;
+  case data::data_type::i32:
+    return H5T_NATIVE_INT32;
+  case data::data_type::u32:
+    return H5T_NATIVE_UINT32;
+  case data::data_type::i64:
+    return H5T_NATIVE_INT64;
+  case data::data_type::u64:
+    return H5T_NATIVE_UINT64;
+  case data::data_type::f32:
+    return H5T_NATIVE_FLOAT;
+  case data::data_type::f64:
+    return H5T_NATIVE_DOUBLE;
+  default:
+    return -1;
+  }
 }
 
-error::error(const char* what)
-  : std::runtime_error{what}
-{
+// storage type matching a C++ type (table unpacking only needs the 8 and 16 bit types)
+template <class T> static auto hdf_data_type() -> data::data_type;
+template <> auto hdf_data_type<int8_t>() -> data::data_type    { return data::data_type::i8; }
+template <> auto hdf_data_type<uint8_t>() -> data::data_type   { return data::data_type::u8; }
+template <> auto hdf_data_type<int16_t>() -> data::data_type   { return data::data_type::i16; }
+template <> auto hdf_data_type<uint16_t>() -> data::data_type  { return data::data_type::u16; }
+
+// parameters needed to unpack a layer into user type T
+template <typename T>
+struct unpack_params
+{
+  double  gain;
+  double  offset;
+  double  nodata;
+  double  undetect;
+  T       out_nodata;
+  T       out_undetect;
+};
 
+// determine whether a packed marker value is exactly representable in storage type S
+template <typename S>
+static auto marker_representable(double val) -> bool
+{
+  if (std::is_floating_point<S>::value)
+    return val == val;
+  return val >= static_cast<double>(std::numeric_limits<S>::lowest())
+      && val <= static_cast<double>(std::numeric_limits<S>::max())
+      && static_cast<double>(static_cast<S>(val)) == val;
 }
 
-attribute::attribute(const handle* parent, std::string name, bool existing)
-  : parent_{parent}
-  , name_{std::move(name)}
-  , type_{existing ? data_type::unknown : data_type::uninitialized}
-  , size_{0}
+/* Lookup table unpacking for 8 and 16 bit storage types.  Each possible packed
+ * code is mapped to its unpacked value (with nodata and undetect folded in) so
+ * that unpacking becomes a single gather per element.  Tables are cached by
+ * their packing parameters since every sweep of a volume typically shares the
+ * same packing for a given quantity. */
+template <typename T>
+struct unpack_table
 {
+  data::data_type           type;
+  unpack_params<T>          params;
+  std::shared_ptr<const T>  values;
+};
 
-}
+// maximum number of unpack tables cached for each output type
+static constexpr size_t unpack_table_cache_size = 16;
 
-auto attribute::type() const -> data_type
+// compare unpack parameters bitwise so that NaN replacement values can be matched
+template <typename T>
+static auto unpack_params_equal(const unpack_params<T>& lhs, const unpack_params<T>& rhs) -> bool
 {
-  if (type_ == data_type::unknown)
-    open();
-  return type_;
+  return memcmp(&lhs.gain, &rhs.gain, sizeof(double)) == 0
+      && memcmp(&lhs.offset, &rhs.offset, sizeof(double)) == 0
+      && memcmp(&lhs.nodata, &rhs.nodata, sizeof(double)) == 0
+      && memcmp(&lhs.undetect, &rhs.undetect, sizeof(double)) == 0
+      && memcmp(&lhs.out_nodata, &rhs.out_nodata, sizeof(T)) == 0
+      && memcmp(&lhs.out_undetect, &rhs.out_undetect, sizeof(T)) == 0;
 }
 
-auto attribute::get_boolean() const -> bool
+// unpack kernel specialised on storage type S and output type T
+template <typename S, typename T>
+static auto unpack_kernel(const void* in, T* out, size_t size, const unpack_params<T>& p) -> void
 {
-  if (type_ == data_type::unknown)
-    open();
-  if (type_ != data_type::boolean)
-    throw make_error(open(), "type mismatch", name_.c_str(), "boolean");
-  return size_ == 5;
+  auto src = static_cast<const S*>(in);
+  const auto a = p.gain;
+  const auto b = p.offset;
+
+  // markers which can never be matched are replaced by a value which is never compared
+  const bool has_ud = marker_representable<S>(p.undetect);
+  const bool has_nd = marker_representable<S>(p.nodata);
+  const S ud = has_ud ? static_cast<S>(p.undetect) : S{};
+  const S nd = has_nd ? static_cast<S>(p.nodata) : S{};
+
+  if (has_ud && has_nd)
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      const S v = src[i];
+      out[i] = v == ud ? p.out_undetect : v == nd ? p.out_nodata : static_cast<T>(a * v + b);
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      const S v = src[i];
+      if (has_ud && v == ud)
+        out[i] = p.out_undetect;
+      else if (has_nd && v == nd)
+        out[i] = p.out_nodata;
+      else
+        out[i] = static_cast<T>(a * v + b);
+    }
+  }
 }
 
-auto attribute::get_integer() const -> long
+/* Find or build the lookup table for storage type S.  Returns null if the layer
+ * is too small to justify building a new 16 bit table. */
+template <typename S, typename T>
+static auto unpack_table_for(data::data_type type, const unpack_params<T>& p, size_t size) -> std::shared_ptr<const T>
 {
-  auto hnd = open();
-  if (type_ != data_type::integer)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "integer");
-  long val;
-  if (H5Aread(hnd, H5T_NATIVE_LONG, &val) < 0)
-    throw make_error(hnd, "attribute read", name_.c_str(), "integer");
-  return val;
+  typedef typename std::make_unsigned<S>::type index_t;
+  constexpr size_t entries = size_t(std::numeric_limits<index_t>::max()) + 1;
+
+  static std::mutex mut;
+  static std::vector<unpack_table<T>> cache;
+
+  {
+    std::lock_guard<std::mutex> lock{mut};
+    for (auto i = cache.begin(); i != cache.end(); ++i)
+    {
+      if (i->type == type && unpack_params_equal(i->params, p))
+      {
+        // move to the front so that the most recently used tables are retained
+        auto ret = i->values;
+        std::rotate(cache.begin(), i, i + 1);
+        return ret;
+      }
+    }
+  }
+
+  // not worth building a table that is much larger than the layer itself
+  if (size < entries / 4)
+    return nullptr;
+
+  // build the table by running the arithmetic kernel over every possible code
+  std::unique_ptr<S[]> codes{new S[entries]};
+  for (size_t i = 0; i < entries; ++i)
+    codes[i] = static_cast<S>(static_cast<index_t>(i));
+  std::shared_ptr<T> values{new T[entries], std::default_delete<T[]>()};
+  unpack_kernel<S, T>(codes.get(), values.get(), entries, p);
+
+  std::lock_guard<std::mutex> lock{mut};
+  if (cache.size() == unpack_table_cache_size)
+    cache.pop_back();
+  cache.insert(cache.begin(), unpack_table<T>{type, p, values});
+  return values;
 }
 
-auto attribute::get_real() const -> double
+template <typename S, typename T>
+static auto unpack_table_kernel(const void* in, T* out, size_t size, const unpack_params<T>& p) -> void
 {
-  auto hnd = open();
-  if (type_ != data_type::real)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "real");
-  double val;
-  if (H5Aread(hnd, H5T_NATIVE_DOUBLE, &val) < 0)
-    throw make_error(hnd, "attribute read", name_.c_str(), "real");
-  return val;
+  typedef typename std::make_unsigned<S>::type index_t;
+
+  auto table = unpack_table_for<S, T>(hdf_data_type<S>(), p, size);
+  if (!table)
+  {
+    unpack_kernel<S, T>(in, out, size, p);
+    return;
+  }
+
+  auto src = static_cast<const index_t*>(in);
+  auto lut = table.get();
+  for (size_t i = 0; i < size; ++i)
+    out[i] = lut[src[i]];
 }
 
-auto attribute::get_string() const -> std::string
+template <typename T>
+using unpack_fn = void (*)(const void* in, T* out, size_t size, const unpack_params<T>& p);
+
+// dispatch table of unpack kernels indexed by storage type
+template <typename T>
+static auto unpack_kernel_for(data::data_type type) -> unpack_fn<T>
 {
-  handle type;
+  static const unpack_fn<T> kernels[] =
+  {
+      nullptr
+    , &unpack_table_kernel<int8_t, T>
+    , &unpack_table_kernel<uint8_t, T>
+    , &unpack_table_kernel<int16_t, T>
+    , &unpack_table_kernel<uint16_t, T>
+    , &unpack_kernel<int32_t, T>
+    , &unpack_kernel<uint32_t, T>
+    , &unpack_kernel<int64_t, T>
+    , &unpack_kernel<uint64_t, T>
+    , &unpack_kernel<float, T>
+    , &unpack_kernel<double, T>
+  };
+  static_assert(
+        sizeof(kernels) / sizeof(kernels[0]) == static_cast<size_t>(data::data_type::f64) + 1
+      , "unpack kernel table does not match data_type");
+  return kernels[static_cast<size_t>(type)];
+}
+
+/* Vectorised packing kernels.  The scalar kernel handles every storage type
+ * and is used for the tail of each buffer.  SIMD kernels are provided for the
+ * 8 and 16 bit integer storage types which make up the bulk of ODIM moments.
+ * The AVX2 kernels are only used if the CPU reports support at runtime. */
+template <typename T>
+struct pack_params
+{
+  data::pack_test::kind ud_kind;
+  data::pack_test::kind nd_kind;
+  T                     ud_threshold;
+  T                     nd_threshold;
+  T                     inv_gain;
+  T                     offset;
+  T                     lo;         // lowest packed value available for valid data
+  T                     hi;         // highest packed value available for valid data
+  T                     ud;         // packed undetect value
+  T                     nd;         // packed nodata value
+};
 
-  auto hnd = open(&type);
-  if (type_ != data_type::string)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "string");
+// running summary of packed values
+template <typename T>
+struct pack_reduction
+{
+  size_t  valid;
+  T       min;
+  T       max;
+};
 
-  // use stack allocation for short strings
-  if (size_ < 256)
+template <typename T>
+static inline auto pack_test_match(data::pack_test::kind kind, T threshold, T val) -> bool
+{
+  switch (kind)
   {
-    char* buf = static_cast<char*>(alloca(size_));
-    if (H5Aread(hnd, type, buf) < 0)
-      throw make_error(hnd, "attribute read", name_.c_str(), "string");
-    return {buf, size_ - 1};
+  case data::pack_test::kind::is_nan:
+    return val != val;
+  case data::pack_test::kind::less:
+    return val < threshold;
+  case data::pack_test::kind::less_equal:
+    return val <= threshold;
+  case data::pack_test::kind::greater:
+    return val > threshold;
+  case data::pack_test::kind::greater_equal:
+    return val >= threshold;
+  case data::pack_test::kind::equal:
+    return val == threshold;
+  default:
+    return false;
   }
-  else
+}
+
+template <typename S, typename T>
+static auto pack_kernel_scalar(const T* in, S* out, size_t size, const pack_params<T>& p, pack_reduction<T>& r) -> void
+{
+  for (size_t i = 0; i < size; ++i)
   {
-    std::unique_ptr<char[]> buf{new char[size_]};
-    if (H5Aread(hnd, type, buf.get()) < 0)
-      throw make_error(hnd, "attribute read", name_.c_str(), "string");
-    return {buf.get(), size_ - 1};
+    const T x = in[i];
+    if (pack_test_match(p.ud_kind, p.ud_threshold, x))
+      out[i] = static_cast<S>(p.ud);
+    else if (pack_test_match(p.nd_kind, p.nd_threshold, x))
+      out[i] = static_cast<S>(p.nd);
+    else
+    {
+      T q = (x - p.offset) * p.inv_gain;
+      if (std::is_integral<S>::value)
+      {
+        // written so that NaN inputs saturate to the low end of the range
+        q = std::nearbyint(q);
+        if (!(q >= p.lo))
+          q = p.lo;
+        else if (q > p.hi)
+          q = p.hi;
+      }
+      out[i] = static_cast<S>(q);
+
+      ++r.valid;
+      if (x < r.min)
+        r.min = x;
+      if (x > r.max)
+        r.max = x;
+    }
   }
 }
 
-auto attribute::get_integer_array() const -> std::vector<long>
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ODIM_H5_SIMD_X86 1
+#if defined(_MSC_VER)
+#define ODIM_H5_TARGET_AVX2
+#else
+#define ODIM_H5_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+static auto cpu_has_avx2() -> bool
 {
-  auto hnd = open();
-  if (type_ != data_type::integer_array)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "integer_array");
-  std::vector<long> val(size_);
-  if (H5Aread(hnd, H5T_NATIVE_LONG, &val[0]) < 0)
-    throw make_error(hnd, "attribute read", name_.c_str(), "integer_array");
-  return val;
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
 }
 
-auto attribute::get_real_array() const -> std::vector<double>
+static const bool use_avx2 = cpu_has_avx2();
+
+static inline auto mask_count(int mask) -> size_t
 {
-  auto hnd = open();
-  if (type_ != data_type::real_array)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "real_array");
-  std::vector<double> val(size_);
-  if (H5Aread(hnd, H5T_NATIVE_DOUBLE, &val[0]) < 0)
-    throw make_error(hnd, "attribute read", name_.c_str(), "double_array");
-  return val;
+  static const unsigned char bits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+  return bits[mask & 0xf] + bits[(mask >> 4) & 0xf];
 }
 
-auto attribute::set(bool val) -> void
+// SSE2 - test 4 floats or 2 doubles
+static inline auto sse2_test(data::pack_test::kind kind, __m128 t, __m128 x) -> __m128
 {
-  handle type;
-  auto hnd = open_or_create(data_type::boolean, val ? 5 : 6, &type);
-  if (H5Awrite(hnd, type, val ? "True" : "False") < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "integer");
+  switch (kind)
+  {
+  case data::pack_test::kind::is_nan:
+    return _mm_cmpunord_ps(x, x);
+  case data::pack_test::kind::less:
+    return _mm_cmplt_ps(x, t);
+  case data::pack_test::kind::less_equal:
+    return _mm_cmple_ps(x, t);
+  case data::pack_test::kind::greater:
+    return _mm_cmpgt_ps(x, t);
+  case data::pack_test::kind::greater_equal:
+    return _mm_cmpge_ps(x, t);
+  case data::pack_test::kind::equal:
+    return _mm_cmpeq_ps(x, t);
+  default:
+    return _mm_setzero_ps();
+  }
 }
 
-auto attribute::set(long val) -> void
+static inline auto sse2_test(data::pack_test::kind kind, __m128d t, __m128d x) -> __m128d
 {
-  auto hnd = open_or_create(data_type::integer, 1);
-  if (H5Awrite(hnd, H5T_NATIVE_LONG, &val) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "integer");
+  switch (kind)
+  {
+  case data::pack_test::kind::is_nan:
+    return _mm_cmpunord_pd(x, x);
+  case data::pack_test::kind::less:
+    return _mm_cmplt_pd(x, t);
+  case data::pack_test::kind::less_equal:
+    return _mm_cmple_pd(x, t);
+  case data::pack_test::kind::greater:
+    return _mm_cmpgt_pd(x, t);
+  case data::pack_test::kind::greater_equal:
+    return _mm_cmpge_pd(x, t);
+  case data::pack_test::kind::equal:
+    return _mm_cmpeq_pd(x, t);
+  default:
+    return _mm_setzero_pd();
+  }
 }
 
-auto attribute::set(double val) -> void
+static inline auto sse2_select(__m128 mask, __m128 a, __m128 b) -> __m128
 {
-  auto hnd = open_or_create(data_type::real, 1);
-  if (H5Awrite(hnd, H5T_NATIVE_DOUBLE, &val) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "real");
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
 }
 
-auto attribute::set(const char* val) -> void
+static inline auto sse2_select(__m128d mask, __m128d a, __m128d b) -> __m128d
 {
-  handle type;
-  auto hnd = open_or_create(data_type::string, strlen(val) + 1, &type);
-  if (H5Awrite(hnd, type, val) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "string");
+  return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
 }
 
-auto attribute::set(const std::string& val) -> void
+// SSE2 - narrow and store 4 packed int32 values
+static inline auto sse2_store(__m128i c, int8_t* out) -> void
 {
-  handle type;
-  auto hnd = open_or_create(data_type::string, val.size() + 1, &type);
-  if (H5Awrite(hnd, type, val.c_str()) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "string");
+  c = _mm_packs_epi32(c, c);
+  c = _mm_packs_epi16(c, c);
+  int32_t v = _mm_cvtsi128_si32(c);
+  memcpy(out, &v, 4);
 }
 
-auto attribute::set(const std::vector<long>& val) -> void
+static inline auto sse2_store(__m128i c, uint8_t* out) -> void
 {
-  auto hnd = open_or_create(data_type::integer_array, val.size());
-  if (H5Awrite(hnd, H5T_NATIVE_LONG, val.data()) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "integer_array");
+  c = _mm_packs_epi32(c, c);
+  c = _mm_packus_epi16(c, c);
+  int32_t v = _mm_cvtsi128_si32(c);
+  memcpy(out, &v, 4);
 }
 
-auto attribute::set(const std::vector<double>& val) -> void
+static inline auto sse2_store(__m128i c, int16_t* out) -> void
 {
-  auto hnd = open_or_create(data_type::real_array, val.size());
-  if (H5Awrite(hnd, H5T_NATIVE_DOUBLE, val.data()) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "real_array");
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packs_epi32(c, c));
 }
 
-// open an existing attribute
-auto attribute::open(handle* type_out) const -> handle
+static inline auto sse2_store(__m128i c, uint16_t* out) -> void
 {
-  // attempt to open the attribute
-  handle hnd{H5Aopen(*parent_, name_.c_str(), H5P_DEFAULT)};
-  if (!hnd)
-    throw make_error(*parent_, "attribute open", name_.c_str());
+  // SSE2 has no unsigned 32 to 16 bit pack so bias into the signed range and back
+  c = _mm_sub_epi32(c, _mm_set1_epi32(32768));
+  c = _mm_xor_si128(_mm_packs_epi32(c, c), _mm_set1_epi16(static_cast<short>(0x8000)));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), c);
+}
 
-  // get the size (array elements)
-  handle space{H5Aget_space(hnd)};
-  if (!space)
-    throw make_error(hnd, "get attribute space", name_.c_str());
-  auto hsize = H5Sget_simple_extent_npoints(space);
-  if (hsize < 0)
-    throw make_error(hnd, "get attribute size", name_.c_str());
-  size_ = hsize;
+// SSE2 - quantize 4 values into int32 codes and update the reduction
+static inline auto sse2_quantize(const float* in, const pack_params<float>& p, __m128& vmin, __m128& vmax, size_t& valid) -> __m128i
+{
+  const __m128 x = _mm_loadu_ps(in);
+  const __m128 mu = sse2_test(p.ud_kind, _mm_set1_ps(p.ud_threshold), x);
+  const __m128 mn = sse2_test(p.nd_kind, _mm_set1_ps(p.nd_threshold), x);
+  const __m128 mv = _mm_andnot_ps(_mm_or_ps(mu, mn), _mm_castsi128_ps(_mm_set1_epi32(-1)));
 
-  // determine the type
-  handle type{H5Aget_type(hnd)};
-  if (!type)
-    throw make_error(hnd, "get attribute type", name_.c_str());
-  switch (H5Tget_class(type))
+  __m128 q = _mm_mul_ps(_mm_sub_ps(x, _mm_set1_ps(p.offset)), _mm_set1_ps(p.inv_gain));
+  q = _mm_min_ps(_mm_max_ps(q, _mm_set1_ps(p.lo)), _mm_set1_ps(p.hi));
+  q = sse2_select(mn, _mm_set1_ps(p.nd), q);
+  q = sse2_select(mu, _mm_set1_ps(p.ud), q);
+
+  vmin = _mm_min_ps(sse2_select(mv, x, vmin), vmin);
+  vmax = _mm_max_ps(sse2_select(mv, x, vmax), vmax);
+  valid += mask_count(_mm_movemask_ps(mv));
+
+  return _mm_cvtps_epi32(q);
+}
+
+static inline auto sse2_quantize(const double* in, const pack_params<double>& p, __m128d& vmin, __m128d& vmax, size_t& valid) -> __m128i
+{
+  const __m128d x = _mm_loadu_pd(in);
+  const __m128d mu = sse2_test(p.ud_kind, _mm_set1_pd(p.ud_threshold), x);
+  const __m128d mn = sse2_test(p.nd_kind, _mm_set1_pd(p.nd_threshold), x);
+  const __m128d mv = _mm_andnot_pd(_mm_or_pd(mu, mn), _mm_castsi128_pd(_mm_set1_epi32(-1)));
+
+  __m128d q = _mm_mul_pd(_mm_sub_pd(x, _mm_set1_pd(p.offset)), _mm_set1_pd(p.inv_gain));
+  q = _mm_min_pd(_mm_max_pd(q, _mm_set1_pd(p.lo)), _mm_set1_pd(p.hi));
+  q = sse2_select(mn, _mm_set1_pd(p.nd), q);
+  q = sse2_select(mu, _mm_set1_pd(p.ud), q);
+
+  vmin = _mm_min_pd(sse2_select(mv, x, vmin), vmin);
+  vmax = _mm_max_pd(sse2_select(mv, x, vmax), vmax);
+  valid += mask_count(_mm_movemask_pd(mv));
+
+  return _mm_cvtpd_epi32(q);
+}
+
+template <typename S>
+static auto pack_kernel_sse2(const float* in, S* out, size_t size, const pack_params<float>& p, pack_reduction<float>& r) -> size_t
+{
+  __m128 vmin = _mm_set1_ps(r.min), vmax = _mm_set1_ps(r.max);
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4)
+    sse2_store(sse2_quantize(in + i, p, vmin, vmax, r.valid), out + i);
+
+  float lanes[4];
+  _mm_storeu_ps(lanes, vmin);
+  r.min = *std::min_element(lanes, lanes + 4);
+  _mm_storeu_ps(lanes, vmax);
+  r.max = *std::max_element(lanes, lanes + 4);
+  return i;
+}
+
+template <typename S>
+static auto pack_kernel_sse2(const double* in, S* out, size_t size, const pack_params<double>& p, pack_reduction<double>& r) -> size_t
+{
+  __m128d vmin = _mm_set1_pd(r.min), vmax = _mm_set1_pd(r.max);
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4)
   {
-  case H5T_INTEGER:
-    type_ = size_ > 1 ? data_type::integer_array : data_type::integer;
-    break;
-  case H5T_FLOAT:
-    type_ = size_ > 1 ? data_type::real_array : data_type::real;
-    break;
-  case H5T_STRING:
-    type_ = data_type::string;
-    size_ = H5Tget_size(type);
-    if (size_ == 5 || size_ == 6)
+    const __m128i lo = sse2_quantize(in + i, p, vmin, vmax, r.valid);
+    const __m128i hi = sse2_quantize(in + i + 2, p, vmin, vmax, r.valid);
+    sse2_store(_mm_unpacklo_epi64(lo, hi), out + i);
+  }
+
+  double lanes[2];
+  _mm_storeu_pd(lanes, vmin);
+  r.min = std::min(lanes[0], lanes[1]);
+  _mm_storeu_pd(lanes, vmax);
+  r.max = std::max(lanes[0], lanes[1]);
+  return i;
+}
+
+// AVX2 - test 8 floats or 4 doubles
+ODIM_H5_TARGET_AVX2 static inline auto avx2_test(data::pack_test::kind kind, __m256 t, __m256 x) -> __m256
+{
+  switch (kind)
+  {
+  case data::pack_test::kind::is_nan:
+    return _mm256_cmp_ps(x, x, _CMP_UNORD_Q);
+  case data::pack_test::kind::less:
+    return _mm256_cmp_ps(x, t, _CMP_LT_OQ);
+  case data::pack_test::kind::less_equal:
+    return _mm256_cmp_ps(x, t, _CMP_LE_OQ);
+  case data::pack_test::kind::greater:
+    return _mm256_cmp_ps(x, t, _CMP_GT_OQ);
+  case data::pack_test::kind::greater_equal:
+    return _mm256_cmp_ps(x, t, _CMP_GE_OQ);
+  case data::pack_test::kind::equal:
+    return _mm256_cmp_ps(x, t, _CMP_EQ_OQ);
+  default:
+    return _mm256_setzero_ps();
+  }
+}
+
+ODIM_H5_TARGET_AVX2 static inline auto avx2_test(data::pack_test::kind kind, __m256d t, __m256d x) -> __m256d
+{
+  switch (kind)
+  {
+  case data::pack_test::kind::is_nan:
+    return _mm256_cmp_pd(x, x, _CMP_UNORD_Q);
+  case data::pack_test::kind::less:
+    return _mm256_cmp_pd(x, t, _CMP_LT_OQ);
+  case data::pack_test::kind::less_equal:
+    return _mm256_cmp_pd(x, t, _CMP_LE_OQ);
+  case data::pack_test::kind::greater:
+    return _mm256_cmp_pd(x, t, _CMP_GT_OQ);
+  case data::pack_test::kind::greater_equal:
+    return _mm256_cmp_pd(x, t, _CMP_GE_OQ);
+  case data::pack_test::kind::equal:
+    return _mm256_cmp_pd(x, t, _CMP_EQ_OQ);
+  default:
+    return _mm256_setzero_pd();
+  }
+}
+
+// AVX2 - narrow and store 8 packed int32 values
+ODIM_H5_TARGET_AVX2 static inline auto avx2_store(__m256i c, int8_t* out) -> void
+{
+  __m128i v = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packs_epi32(c, c), 0x08));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packs_epi16(v, v));
+}
+
+ODIM_H5_TARGET_AVX2 static inline auto avx2_store(__m256i c, uint8_t* out) -> void
+{
+  __m128i v = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packs_epi32(c, c), 0x08));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(v, v));
+}
+
+ODIM_H5_TARGET_AVX2 static inline auto avx2_store(__m256i c, int16_t* out) -> void
+{
+  __m128i v = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packs_epi32(c, c), 0x08));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+}
+
+ODIM_H5_TARGET_AVX2 static inline auto avx2_store(__m256i c, uint16_t* out) -> void
+{
+  __m128i v = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(c, c), 0x08));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+}
+
+template <typename S>
+ODIM_H5_TARGET_AVX2 static auto pack_kernel_avx2(const float* in, S* out, size_t size, const pack_params<float>& p, pack_reduction<float>& r) -> size_t
+{
+  const __m256 ut = _mm256_set1_ps(p.ud_threshold), nt = _mm256_set1_ps(p.nd_threshold);
+  const __m256 b = _mm256_set1_ps(p.offset), a = _mm256_set1_ps(p.inv_gain);
+  const __m256 lo = _mm256_set1_ps(p.lo), hi = _mm256_set1_ps(p.hi);
+  const __m256 ud = _mm256_set1_ps(p.ud), nd = _mm256_set1_ps(p.nd);
+  const __m256 ones = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  __m256 vmin = _mm256_set1_ps(r.min), vmax = _mm256_set1_ps(r.max);
+
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    const __m256 x = _mm256_loadu_ps(in + i);
+    const __m256 mu = avx2_test(p.ud_kind, ut, x);
+    const __m256 mn = avx2_test(p.nd_kind, nt, x);
+    const __m256 mv = _mm256_andnot_ps(_mm256_or_ps(mu, mn), ones);
+
+    __m256 q = _mm256_mul_ps(_mm256_sub_ps(x, b), a);
+    q = _mm256_min_ps(_mm256_max_ps(q, lo), hi);
+    q = _mm256_blendv_ps(q, nd, mn);
+    q = _mm256_blendv_ps(q, ud, mu);
+    avx2_store(_mm256_cvtps_epi32(q), out + i);
+
+    vmin = _mm256_min_ps(_mm256_blendv_ps(vmin, x, mv), vmin);
+    vmax = _mm256_max_ps(_mm256_blendv_ps(vmax, x, mv), vmax);
+    r.valid += mask_count(_mm256_movemask_ps(mv));
+  }
+
+  float lanes[8];
+  _mm256_storeu_ps(lanes, vmin);
+  r.min = *std::min_element(lanes, lanes + 8);
+  _mm256_storeu_ps(lanes, vmax);
+  r.max = *std::max_element(lanes, lanes + 8);
+  return i;
+}
+
+template <typename S>
+ODIM_H5_TARGET_AVX2 static auto pack_kernel_avx2(const double* in, S* out, size_t size, const pack_params<double>& p, pack_reduction<double>& r) -> size_t
+{
+  const __m256d ut = _mm256_set1_pd(p.ud_threshold), nt = _mm256_set1_pd(p.nd_threshold);
+  const __m256d b = _mm256_set1_pd(p.offset), a = _mm256_set1_pd(p.inv_gain);
+  const __m256d lo = _mm256_set1_pd(p.lo), hi = _mm256_set1_pd(p.hi);
+  const __m256d ud = _mm256_set1_pd(p.ud), nd = _mm256_set1_pd(p.nd);
+  const __m256d ones = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+  __m256d vmin = _mm256_set1_pd(r.min), vmax = _mm256_set1_pd(r.max);
+
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    __m128i codes[2];
+    for (size_t j = 0; j < 2; ++j)
     {
-      char buf[6];
-      if (H5Aread(hnd, type, buf) < 0)
-        throw make_error(hnd, "read attribute", name_.c_str());
-      if (strcmp(buf, "True") == 0 || strcmp(buf, "False") == 0)
-        type_ = data_type::boolean;
+      const __m256d x = _mm256_loadu_pd(in + i + j * 4);
+      const __m256d mu = avx2_test(p.ud_kind, ut, x);
+      const __m256d mn = avx2_test(p.nd_kind, nt, x);
+      const __m256d mv = _mm256_andnot_pd(_mm256_or_pd(mu, mn), ones);
+
+      __m256d q = _mm256_mul_pd(_mm256_sub_pd(x, b), a);
+      q = _mm256_min_pd(_mm256_max_pd(q, lo), hi);
+      q = _mm256_blendv_pd(q, nd, mn);
+      q = _mm256_blendv_pd(q, ud, mu);
+      codes[j] = _mm256_cvtpd_epi32(q);
+
+      vmin = _mm256_min_pd(_mm256_blendv_pd(vmin, x, mv), vmin);
+      vmax = _mm256_max_pd(_mm256_blendv_pd(vmax, x, mv), vmax);
+      r.valid += mask_count(_mm256_movemask_pd(mv));
     }
+    avx2_store(_mm256_inserti128_si256(_mm256_castsi128_si256(codes[0]), codes[1], 1), out + i);
+  }
+
+  double lanes[4];
+  _mm256_storeu_pd(lanes, vmin);
+  r.min = *std::min_element(lanes, lanes + 4);
+  _mm256_storeu_pd(lanes, vmax);
+  r.max = *std::max_element(lanes, lanes + 4);
+  return i;
+}
+
+template <typename S, typename T>
+static auto pack_kernel_simd(const T* in, S* out, size_t size, const pack_params<T>& p, pack_reduction<T>& r, std::true_type) -> size_t
+{
+  return use_avx2 ? pack_kernel_avx2(in, out, size, p, r) : pack_kernel_sse2(in, out, size, p, r);
+}
+#endif
+
+// storage types without a SIMD kernel are handled entirely by the scalar kernel
+template <typename S, typename T>
+static auto pack_kernel_simd(const T* in, S* out, size_t size, const pack_params<T>& p, pack_reduction<T>& r, std::false_type) -> size_t
+{
+  return 0;
+}
+
+// use the SIMD kernel where possible and finish the tail with the scalar kernel
+template <typename S, typename T>
+static auto pack_kernel(const T* in, void* buf, size_t size, const pack_params<T>& p, pack_reduction<T>& r) -> void
+{
+#if ODIM_H5_SIMD_X86
+  typedef std::integral_constant<bool, std::is_integral<S>::value && sizeof(S) <= 2> has_simd;
+#else
+  typedef std::false_type has_simd;
+#endif
+  auto out = static_cast<S*>(buf);
+  auto done = pack_kernel_simd(in, out, size, p, r, has_simd{});
+  pack_kernel_scalar(in + done, out + done, size - done, p, r);
+}
+
+template <typename T>
+using pack_fn = void (*)(const T* in, void* buf, size_t size, const pack_params<T>& p, pack_reduction<T>& r);
+
+// dispatch table of pack kernels indexed by storage type
+template <typename T>
+static auto pack_kernel_for(data::data_type type) -> pack_fn<T>
+{
+  static const pack_fn<T> kernels[] =
+  {
+      nullptr
+    , &pack_kernel<int8_t, T>
+    , &pack_kernel<uint8_t, T>
+    , &pack_kernel<int16_t, T>
+    , &pack_kernel<uint16_t, T>
+    , &pack_kernel<int32_t, T>
+    , &pack_kernel<uint32_t, T>
+    , &pack_kernel<int64_t, T>
+    , &pack_kernel<uint64_t, T>
+    , &pack_kernel<float, T>
+    , &pack_kernel<double, T>
+  };
+  static_assert(
+        sizeof(kernels) / sizeof(kernels[0]) == static_cast<size_t>(data::data_type::f64) + 1
+      , "pack kernel table does not match data_type");
+  return kernels[static_cast<size_t>(type)];
+}
+
+// range of packed values which may be used for valid data in a storage type
+static auto pack_range(data::data_type type, double ud, double nd) -> std::pair<double, double>
+{
+  double lo, hi;
+  switch (type)
+  {
+  case data::data_type::i8:
+    lo = std::numeric_limits<int8_t>::lowest(), hi = std::numeric_limits<int8_t>::max();
+    break;
+  case data::data_type::u8:
+    lo = std::numeric_limits<uint8_t>::lowest(), hi = std::numeric_limits<uint8_t>::max();
+    break;
+  case data::data_type::i16:
+    lo = std::numeric_limits<int16_t>::lowest(), hi = std::numeric_limits<int16_t>::max();
+    break;
+  case data::data_type::u16:
+    lo = std::numeric_limits<uint16_t>::lowest(), hi = std::numeric_limits<uint16_t>::max();
+    break;
+  case data::data_type::i32:
+    lo = std::numeric_limits<int32_t>::lowest(), hi = std::numeric_limits<int32_t>::max();
+    break;
+  case data::data_type::u32:
+    lo = std::numeric_limits<uint32_t>::lowest(), hi = std::numeric_limits<uint32_t>::max();
+    break;
+  case data::data_type::i64:
+    // largest doubles which convert to the 64 bit types without overflow
+    lo = -9223372036854775808.0, hi = 9223372036854774784.0;
+    break;
+  case data::data_type::u64:
+    lo = 0.0, hi = 18446744073709549568.0;
     break;
   default:
-    type_ = data_type::unknown;
+    return {-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
   }
 
-  // return the type to the caller if needed
-  if (type_out)
-    *type_out = std::move(type);
+  // reserve the ends of the range if they are used by the special values
+  while (lo < hi && (lo == ud || lo == nd))
+    lo += 1.0;
+  while (hi > lo && (hi == ud || hi == nd))
+    hi -= 1.0;
+  return {lo, hi};
+}
 
-  return hnd;
+// conversion kernel used when reading without unpacking
+template <typename S, typename T>
+static auto convert_kernel(const void* in, T* out, size_t size, const unpack_params<T>& p) -> void
+{
+  auto src = static_cast<const S*>(in);
+  for (size_t i = 0; i < size; ++i)
+    out[i] = static_cast<T>(src[i]);
 }
 
-auto attribute::open_or_create(data_type type, size_t size, handle* type_out) -> handle
+// dispatch table of conversion kernels indexed by storage type
+template <typename T>
+static auto convert_kernel_for(data::data_type type) -> unpack_fn<T>
 {
-  if (type_ != data_type::uninitialized)
+  static const unpack_fn<T> kernels[] =
   {
-    // if type is a match, just open as normal
-    if (type_ == type && size_ == size)
-      return open(type_out);
+      nullptr
+    , &convert_kernel<int8_t, T>
+    , &convert_kernel<uint8_t, T>
+    , &convert_kernel<int16_t, T>
+    , &convert_kernel<uint16_t, T>
+    , &convert_kernel<int32_t, T>
+    , &convert_kernel<uint32_t, T>
+    , &convert_kernel<int64_t, T>
+    , &convert_kernel<uint64_t, T>
+    , &convert_kernel<float, T>
+    , &convert_kernel<double, T>
+  };
+  static_assert(
+        sizeof(kernels) / sizeof(kernels[0]) == static_cast<size_t>(data::data_type::f64) + 1
+      , "convert kernel table does not match data_type");
+  return kernels[static_cast<size_t>(type)];
+}
+
+// convert a value to the storage type, saturating at the limits of the storage type
+template <typename S, typename T>
+static auto store_cast(T val, std::true_type /* integral */) -> S
+{
+  if (!std::is_integral<S>::value)
+    return static_cast<S>(val);
+  if (val < T(0))
+    return std::is_signed<S>::value && static_cast<intmax_t>(val) >= static_cast<intmax_t>(std::numeric_limits<S>::lowest())
+      ? static_cast<S>(val)
+      : std::numeric_limits<S>::lowest();
+  return static_cast<uintmax_t>(val) > static_cast<uintmax_t>(std::numeric_limits<S>::max())
+    ? std::numeric_limits<S>::max()
+    : static_cast<S>(val);
+}
+
+template <typename S, typename T>
+static auto store_cast(T val, std::false_type /* integral */) -> S
+{
+  if (!std::is_integral<S>::value)
+    return static_cast<S>(val);
+  if (val != val)
+    return S(0);
+  if (val <= static_cast<T>(std::numeric_limits<S>::lowest()))
+    return std::numeric_limits<S>::lowest();
+  if (val >= static_cast<T>(std::numeric_limits<S>::max()))
+    return std::numeric_limits<S>::max();
+  return static_cast<S>(val);
+}
+
+// conversion kernel used when writing without packing
+template <typename T>
+using store_fn = void (*)(const T* in, void* out, size_t size);
 
-    // typemismatch - delete existing attribute
-    if (type_ != data_type::uninitialized)
+template <typename S, typename T>
+static auto store_kernel(const T* in, void* out, size_t size) -> void
+{
+  auto dst = static_cast<S*>(out);
+  for (size_t i = 0; i < size; ++i)
+    dst[i] = store_cast<S>(in[i], std::is_integral<T>{});
+}
+
+// dispatch table of store kernels indexed by storage type
+template <typename T>
+static auto store_kernel_for(data::data_type type) -> store_fn<T>
+{
+  static const store_fn<T> kernels[] =
+  {
+      nullptr
+    , &store_kernel<int8_t, T>
+    , &store_kernel<uint8_t, T>
+    , &store_kernel<int16_t, T>
+    , &store_kernel<uint16_t, T>
+    , &store_kernel<int32_t, T>
+    , &store_kernel<uint32_t, T>
+    , &store_kernel<int64_t, T>
+    , &store_kernel<uint64_t, T>
+    , &store_kernel<float, T>
+    , &store_kernel<double, T>
+  };
+  static_assert(
+        sizeof(kernels) / sizeof(kernels[0]) == static_cast<size_t>(data::data_type::f64) + 1
+      , "store kernel table does not match data_type");
+  return kernels[static_cast<size_t>(type)];
+}
+
+/* Library worker pool.  Jobs run on the pool must never call into the HDF5
+ * library since it is not built thread-safe in general.  All HDF5 access is
+ * performed on the calling thread and only decompression and unpacking is
+ * farmed out to the pool. */
+class worker_pool
+{
+public:
+  worker_pool(size_t threads)
+    : stop_{false}
+  {
+    for (size_t i = 0; i < threads; ++i)
+      threads_.emplace_back([this]{ run(); });
+  }
+
+  ~worker_pool()
+  {
     {
-      if (H5Adelete(*parent_, name_.c_str()) < 0)
-        throw make_error(*parent_, "delete attribute", name_.c_str());
+      std::lock_guard<std::mutex> lock{mut_};
+      stop_ = true;
     }
+    cv_.notify_all();
+    for (auto& t : threads_)
+      t.join();
   }
 
-  type_ = type;
-  size_ = size;
+  auto size() const -> size_t
+  {
+    return threads_.size();
+  }
 
-  // create the new attribute
-  switch (type)
+  auto submit(std::function<void()> job) -> void
   {
-  case data_type::boolean:
     {
-      handle type{H5Tcopy(H5T_C_S1)};
-      if (   !type
-          || H5Tset_size(type, size) < 0
-          || H5Tset_strpad(type, H5T_STR_NULLTERM) < 0)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle space{H5Screate(H5S_SCALAR)};
-      handle hnd{H5Acreate(*parent_, name_.c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      if (type_out)
-        *type_out = std::move(type);
-      return hnd;
+      std::lock_guard<std::mutex> lock{mut_};
+      jobs_.push_back(std::move(job));
     }
-  case data_type::integer:
+    cv_.notify_one();
+  }
+
+private:
+  auto run() -> void
+  {
+    while (true)
     {
-      handle space{H5Screate(H5S_SCALAR)};
-      if (!space)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_STD_I64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      return hnd;
+      std::function<void()> job;
+      {
+        std::unique_lock<std::mutex> lock{mut_};
+        cv_.wait(lock, [this]{ return stop_ || !jobs_.empty(); });
+        if (jobs_.empty())
+          return;
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+      }
+      job();
     }
-  case data_type::real:
+  }
+
+private:
+  std::mutex                        mut_;
+  std::condition_variable           cv_;
+  std::deque<std::function<void()>> jobs_;
+  std::vector<std::thread>          threads_;
+  bool                              stop_;
+};
+
+static std::mutex                   pool_mut;
+static std::unique_ptr<worker_pool> pool_instance;
+
+static auto worker_pool_instance() -> worker_pool&
+{
+  std::lock_guard<std::mutex> lock{pool_mut};
+  if (!pool_instance)
+    pool_instance.reset(new worker_pool{std::max<size_t>(1, std::thread::hardware_concurrency())});
+  return *pool_instance;
+}
+
+// group of jobs submitted to the worker pool which may be waited on together
+class task_group
+{
+public:
+  task_group()
+    : state_{std::make_shared<state>()}
+  { }
+
+  task_group(const task_group&) = delete;
+  auto operator=(const task_group&) -> task_group& = delete;
+
+  ~task_group()
+  {
+    std::unique_lock<std::mutex> lock{state_->mut};
+    state_->cv.wait(lock, [this]{ return state_->pending == 0; });
+  }
+
+  auto run(std::function<void()> job) -> void
+  {
     {
-      handle space{H5Screate(H5S_SCALAR)};
-      if (!space)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      return hnd;
+      std::lock_guard<std::mutex> lock{state_->mut};
+      ++state_->pending;
     }
-  case data_type::string:
+    auto st = state_;
+    worker_pool_instance().submit([st, job]
     {
-      handle type{H5Tcopy(H5T_C_S1)};
-      if (   !type
-          || H5Tset_size(type, size) < 0
-          || H5Tset_strpad(type, H5T_STR_NULLTERM) < 0)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle space{H5Screate(H5S_SCALAR)};
-      handle hnd{H5Acreate(*parent_, name_.c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      if (type_out)
-        *type_out = std::move(type);
-      return hnd;
-    }
-  case data_type::integer_array:
+      std::exception_ptr err;
+      try
+      {
+        job();
+      }
+      catch (...)
+      {
+        err = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock{st->mut};
+      if (err && !st->error)
+        st->error = err;
+      if (--st->pending == 0)
+        st->cv.notify_all();
+    });
+  }
+
+  // wait for all jobs to complete and rethrow the first error encountered
+  auto wait() -> void
+  {
+    std::unique_lock<std::mutex> lock{state_->mut};
+    state_->cv.wait(lock, [this]{ return state_->pending == 0; });
+    if (state_->error)
     {
-      hsize_t dim = size;
-      handle space{H5Screate_simple(1, &dim, nullptr)};
-      if (!space)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_STD_I64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      return hnd;
+      auto err = state_->error;
+      state_->error = nullptr;
+      std::rethrow_exception(err);
     }
-  case data_type::real_array:
+  }
+
+private:
+  struct state
+  {
+    std::mutex              mut;
+    std::condition_variable cv;
+    size_t                  pending = 0;
+    std::exception_ptr      error;
+  };
+
+private:
+  std::shared_ptr<state> state_;
+};
+
+/* Group of jobs submitted to the worker pool which completes a future rather
+ * than being waited on.  The promise is satisfied once the group has been
+ * closed and every job has finished, with the first error encountered. */
+class async_group
+{
+public:
+  async_group()
+    : state_{std::make_shared<state>()}
+  { }
+
+  async_group(const async_group&) = delete;
+  auto operator=(const async_group&) -> async_group& = delete;
+
+  auto future() -> std::future<void>
+  {
+    return state_->done.get_future();
+  }
+
+  auto run(std::function<void()> job) -> void
+  {
     {
-      hsize_t dim = size;
-      handle space{H5Screate_simple(1, &dim, nullptr)};
-      if (!space)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      return hnd;
+      std::lock_guard<std::mutex> lock{state_->mut};
+      ++state_->pending;
     }
-  default:
-    /* unreacable */
-    throw make_error(*parent_, "create attribute", name_.c_str());
+    auto st = state_;
+    worker_pool_instance().submit([st, job]
+    {
+      std::exception_ptr err;
+      try
+      {
+        job();
+      }
+      catch (...)
+      {
+        err = std::current_exception();
+      }
+      finish(st, err);
+    });
+  }
+
+  // record an error encountered while submitting jobs
+  auto fail(std::exception_ptr err) -> void
+  {
+    std::lock_guard<std::mutex> lock{state_->mut};
+    if (!state_->error)
+      state_->error = err;
+  }
+
+  // no more jobs will be submitted, complete the future once the last job finishes
+  auto close() -> void
+  {
+    finish(state_, nullptr);
+  }
+
+private:
+  struct state
+  {
+    std::mutex          mut;
+    size_t              pending = 1;    // held open until close()
+    std::exception_ptr  error;
+    std::promise<void>  done;
+  };
+
+  static auto finish(const std::shared_ptr<state>& st, std::exception_ptr err) -> void
+  {
+    std::unique_lock<std::mutex> lock{st->mut};
+    if (err && !st->error)
+      st->error = err;
+    if (--st->pending > 0)
+      return;
+    lock.unlock();
+    if (st->error)
+      st->done.set_exception(st->error);
+    else
+      st->done.set_value();
+  }
+
+private:
+  std::shared_ptr<state> state_;
+};
+
+/* Raw (still compressed) chunks of a layer fetched using direct chunk reads.
+ * Fetching requires the HDF5 library, but decoding the chunks does not and may
+ * therefore be performed on the worker pool. */
+struct raw_chunk
+{
+  hsize_t                     offset[H5S_MAX_RANK];
+  uint32_t                    filter_mask;
+  std::vector<unsigned char>  bytes;
+};
+
+struct raw_layer
+{
+  data::data_type type;
+  int             rank;
+  hsize_t         dims[H5S_MAX_RANK];
+  hsize_t         chunk[H5S_MAX_RANK];
+  int             shuffle;                // index of shuffle in the filter pipeline, or -1
+  int             deflate;                // index of deflate in the filter pipeline, or -1
+  int             level;                  // deflate compression level
+};
+
+// apply the byte shuffle filter to a chunk (equivalent to the HDF5 shuffle filter)
+static auto shuffle_bytes(const unsigned char* in, unsigned char* out, size_t count, size_t tsize) -> void
+{
+  for (size_t b = 0; b < tsize; ++b)
+    for (size_t i = 0; i < count; ++i)
+      out[b * count + i] = in[i * tsize + b];
+}
+
+// reverse the byte shuffle filter
+static auto unshuffle_bytes(const unsigned char* in, unsigned char* out, size_t count, size_t tsize) -> void
+{
+  for (size_t b = 0; b < tsize; ++b)
+    for (size_t i = 0; i < count; ++i)
+      out[i * tsize + b] = in[b * count + i];
+}
+
+// number of chunks in a layer
+static auto raw_layer_chunks(const raw_layer& layer) -> size_t
+{
+  size_t nchunks = 1;
+  for (int i = 0; i < layer.rank; ++i)
+    nchunks *= (layer.dims[i] + layer.chunk[i] - 1) / layer.chunk[i];
+  return nchunks;
+}
+
+// determine the offset of the chunk at the given position in row-major chunk order
+static auto raw_layer_chunk_offset(const raw_layer& layer, size_t n, hsize_t* offset) -> void
+{
+  for (int i = layer.rank - 1; i >= 0; --i)
+  {
+    auto grid = (layer.dims[i] + layer.chunk[i] - 1) / layer.chunk[i];
+    offset[i] = (n % grid) * layer.chunk[i];
+    n /= grid;
+  }
+}
+
+/* Call fn(chunk_index, layer_index, count) for each contiguous run of elements
+ * in the chunk at offset which lies within the layer.  Runs along the innermost
+ * dimension are merged when the chunk spans all inner dimensions of the layer. */
+template <class Fn>
+static auto raw_layer_chunk_runs(const raw_layer& layer, const hsize_t* offset, Fn fn) -> void
+{
+  // determine the extent of the chunk which lies within the dataset (edge chunks are padded)
+  hsize_t extent[H5S_MAX_RANK];
+  for (int i = 0; i < layer.rank; ++i)
+    extent[i] = std::min(layer.chunk[i], layer.dims[i] - offset[i]);
+
+  // if the chunk spans all inner dimensions then it maps onto a contiguous block of the layer
+  bool contiguous = true;
+  for (int i = 1; i < layer.rank; ++i)
+    contiguous = contiguous && layer.chunk[i] == layer.dims[i];
+  if (contiguous)
+  {
+    size_t row = 1;
+    for (int i = 1; i < layer.rank; ++i)
+      row *= layer.dims[i];
+    fn(0, offset[0] * row, extent[0] * row);
+    return;
+  }
+
+  // otherwise process each run along the innermost dimension separately
+  const int last = layer.rank - 1;
+  hsize_t index[H5S_MAX_RANK] = { 0 };
+  while (true)
+  {
+    size_t src = 0, dst = 0;
+    for (int i = 0; i < layer.rank; ++i)
+    {
+      src = src * layer.chunk[i] + index[i];
+      dst = dst * layer.dims[i] + offset[i] + index[i];
+    }
+    fn(src, dst, extent[last]);
+
+    int i = last - 1;
+    for (; i >= 0 && ++index[i] == extent[i]; --i)
+      index[i] = 0;
+    if (i < 0)
+      break;
+  }
+}
+
+// determine whether a layer may be decoded without the HDF5 library
+static auto raw_layer_open(const handle& hnd, const handle& dset, data::data_type type, raw_layer& layer) -> bool
+{
+  // direct chunk reads and writes require HDF5 1.10.2
+  if (!H5_VERSION_GE(1,10,2) || storage_type_size(type) == 0)
+    return false;
+  layer.type = type;
+
+  // the stored byte order must match our own since we bypass HDF5 conversion
+  handle ftype{H5Dget_type(dset)};
+  if (!ftype)
+    throw make_error(hnd, "get dataset type", "data");
+  if (H5Tget_size(ftype) > 1 && H5Tget_order(ftype) != H5Tget_order(hdf_memory_type(type)))
+    return false;
+
+  handle plist{H5Dget_create_plist(dset)};
+  if (!plist)
+    throw make_error(hnd, "get dataset properties", "data");
+  if (H5Pget_layout(plist) != H5D_CHUNKED)
+    return false;
+
+  handle space{H5Dget_space(dset)};
+  if (!space)
+    throw make_error(hnd, "get dataset space", "data");
+  layer.rank = H5Sget_simple_extent_dims(space, layer.dims, nullptr);
+  if (layer.rank <= 0 || H5Pget_chunk(plist, layer.rank, layer.chunk) != layer.rank)
+    return false;
+
+  // we can only decode the shuffle and deflate filters ourselves, and only in that order
+  layer.shuffle = -1;
+  layer.deflate = -1;
+  layer.level = 0;
+  auto nfilters = H5Pget_nfilters(plist);
+  for (int i = 0; i < nfilters; ++i)
+  {
+    unsigned int flags, config, values[1];
+    size_t nelmts = 1;
+    auto id = H5Pget_filter2(plist, i, &flags, &nelmts, values, 0, nullptr, &config);
+    if (id == H5Z_FILTER_SHUFFLE && layer.shuffle < 0 && layer.deflate < 0)
+      layer.shuffle = i;
+    else if (id == H5Z_FILTER_DEFLATE && layer.deflate < 0)
+    {
+      layer.deflate = i;
+      layer.level = nelmts > 0 ? static_cast<int>(values[0]) : Z_DEFAULT_COMPRESSION;
+    }
+    else
+      return false;
+  }
+  return true;
+}
+
+// fetch the raw chunks of a layer passing each one to the supplied callback
+template <class Sink>
+static auto raw_layer_fetch(const handle& hnd, const handle& dset, const raw_layer& layer, Sink sink) -> bool
+{
+#if H5_VERSION_GE(1,10,2)
+  // check that every chunk has been allocated before fetching any of them
+  const auto nchunks = raw_layer_chunks(layer);
+  std::vector<hsize_t> sizes(nchunks);
+  for (size_t n = 0; n < nchunks; ++n)
+  {
+    hsize_t offset[H5S_MAX_RANK];
+    raw_layer_chunk_offset(layer, n, offset);
+    if (H5Dget_chunk_storage_size(dset, offset, &sizes[n]) < 0)
+      throw make_error(hnd, "get chunk size", "data");
+    if (sizes[n] == 0)
+      return false;
+  }
+
+  for (size_t n = 0; n < nchunks; ++n)
+  {
+    raw_chunk chunk;
+    raw_layer_chunk_offset(layer, n, chunk.offset);
+    chunk.bytes.resize(sizes[n]);
+    if (H5Dread_chunk(dset, H5P_DEFAULT, chunk.offset, &chunk.filter_mask, chunk.bytes.data()) < 0)
+      throw make_error(hnd, "read chunk", "data");
+    sink(std::move(chunk));
+  }
+  return true;
+#else
+  // direct chunk reads were introduced in HDF5 1.10.2
+  (void) hnd; (void) dset; (void) layer; (void) sink;
+  return false;
+#endif
+}
+
+// decode a single raw chunk into the output array (does not use the HDF5 library)
+template <typename T>
+static auto raw_chunk_decode(
+      const raw_layer& layer
+    , const raw_chunk& chunk
+    , T* out
+    , unpack_fn<T> kernel
+    , const unpack_params<T>& params
+    ) -> void
+{
+  const size_t tsize = storage_type_size(layer.type);
+  size_t chunk_size = 1;
+  for (int i = 0; i < layer.rank; ++i)
+    chunk_size *= layer.chunk[i];
+
+  // decompress the chunk into its storage type
+  const unsigned char* buf;
+  std::unique_ptr<unsigned char[]> inflated;
+  if (layer.deflate >= 0 && (chunk.filter_mask & (1u << layer.deflate)) == 0)
+  {
+    inflated.reset(new unsigned char[chunk_size * tsize]);
+    uLongf len = chunk_size * tsize;
+    if (   uncompress(inflated.get(), &len, chunk.bytes.data(), chunk.bytes.size()) != Z_OK
+        || len != chunk_size * tsize)
+      throw make_error({}, "decompress chunk", "data", "inflate failed");
+    buf = inflated.get();
+  }
+  else
+  {
+    if (chunk.bytes.size() != chunk_size * tsize)
+      throw make_error({}, "decode chunk", "data", "unexpected chunk size");
+    buf = chunk.bytes.data();
+  }
+
+  // reverse the byte shuffle
+  std::unique_ptr<unsigned char[]> unshuffled;
+  if (layer.shuffle >= 0 && (chunk.filter_mask & (1u << layer.shuffle)) == 0 && tsize > 1)
+  {
+    unshuffled.reset(new unsigned char[chunk_size * tsize]);
+    unshuffle_bytes(buf, unshuffled.get(), chunk_size, tsize);
+    buf = unshuffled.get();
+  }
+
+  raw_layer_chunk_runs(layer, chunk.offset, [&](size_t src, size_t dst, size_t count)
+  {
+    kernel(buf + src * tsize, out + dst, count, params);
+  });
+}
+
+// fetch the chunks of a layer and decode them in parallel on the worker pool
+template <typename T>
+static auto raw_layer_read(
+      const handle& hnd
+    , const handle& dset
+    , const raw_layer& layer
+    , T* out
+    , unpack_fn<T> kernel
+    , const unpack_params<T>& params
+    ) -> bool
+{
+  task_group tasks;
+  auto ret = raw_layer_fetch(hnd, dset, layer, [&](raw_chunk&& chunk)
+  {
+    auto ptr = std::make_shared<raw_chunk>(std::move(chunk));
+    tasks.run([&layer, ptr, out, kernel, &params]
+    {
+      raw_chunk_decode(layer, *ptr, out, kernel, params);
+    });
+  });
+  tasks.wait();
+  return ret;
+}
+
+// fetch the chunks of a layer and queue their decoding on the worker pool without waiting
+template <typename T>
+static auto raw_layer_read_async(
+      const handle& hnd
+    , const handle& dset
+    , const std::shared_ptr<const raw_layer>& layer
+    , T* out
+    , unpack_fn<T> kernel
+    , const unpack_params<T>& params
+    , async_group& tasks
+    ) -> bool
+{
+  return raw_layer_fetch(hnd, dset, *layer, [&](raw_chunk&& chunk)
+  {
+    auto ptr = std::make_shared<raw_chunk>(std::move(chunk));
+    tasks.run([layer, ptr, out, kernel, params]
+    {
+      raw_chunk_decode(*layer, *ptr, out, kernel, params);
+    });
+  });
+}
+
+/* Encode the chunks of a layer in parallel on the worker pool and commit them
+ * in order using direct chunk writes on the calling thread.  The encode
+ * function is called on the worker threads as encode(chunk, index, count, out)
+ * for each run of elements within a chunk.  The number of chunks in flight is
+ * bounded to limit memory use. */
+template <class Encode>
+static auto raw_layer_write(const handle& hnd, const handle& dset, const raw_layer& layer, Encode encode) -> void
+{
+  const size_t tsize = storage_type_size(layer.type);
+  size_t chunk_size = 1;
+  for (int i = 0; i < layer.rank; ++i)
+    chunk_size *= layer.chunk[i];
+  const auto nchunks = raw_layer_chunks(layer);
+  const auto window = 2 * worker_pool_instance().size();
+
+  std::deque<std::future<raw_chunk>> pending;
+  task_group tasks;
+  size_t next = 0;
+  auto submit = [&]
+  {
+    auto n = next++;
+    auto result = std::make_shared<std::promise<raw_chunk>>();
+    pending.push_back(result->get_future());
+    tasks.run([&layer, &encode, tsize, chunk_size, n, result]
+    {
+      try
+      {
+        raw_chunk chunk;
+        raw_layer_chunk_offset(layer, n, chunk.offset);
+        chunk.filter_mask = 0;
+
+        // edge chunks are padded with zeros
+        std::vector<unsigned char> buf(chunk_size * tsize);
+        raw_layer_chunk_runs(layer, chunk.offset, [&](size_t src, size_t dst, size_t count)
+        {
+          encode(n, dst, count, buf.data() + src * tsize);
+        });
+
+        if (layer.shuffle >= 0 && tsize > 1)
+        {
+          std::vector<unsigned char> shuffled(buf.size());
+          shuffle_bytes(buf.data(), shuffled.data(), chunk_size, tsize);
+          buf.swap(shuffled);
+        }
+
+        if (layer.deflate >= 0)
+        {
+          uLongf len = compressBound(buf.size());
+          chunk.bytes.resize(len);
+          if (compress2(chunk.bytes.data(), &len, buf.data(), buf.size(), layer.level) != Z_OK)
+            throw make_error({}, "compress chunk", "data", "deflate failed");
+          chunk.bytes.resize(len);
+        }
+        else
+          chunk.bytes = std::move(buf);
+        result->set_value(std::move(chunk));
+      }
+      catch (...)
+      {
+        result->set_exception(std::current_exception());
+      }
+    });
+  };
+
+  while (next < nchunks && next < window)
+    submit();
+  while (!pending.empty())
+  {
+    auto chunk = pending.front().get();
+    pending.pop_front();
+    if (next < nchunks)
+      submit();
+#if H5_VERSION_GE(1,10,2)
+    auto err = H5Dwrite_chunk(dset, H5P_DEFAULT, chunk.filter_mask, chunk.offset, chunk.bytes.size(), chunk.bytes.data());
+    if (err < 0)
+      throw make_error(hnd, "write chunk", "data", err);
+#else
+    // unreachable since raw_layer_open() rejects every layer
+    (void) dset;
+    throw make_error(hnd, "write chunk", "data", "direct chunk writes require HDF5 1.10.2");
+#endif
+  }
+}
+
+static auto strings_to_time(const std::string& date, const std::string& time) -> time_t
+{
+  struct tm tms;
+  if (   sscanf_s(date.c_str(), "%04d%02d%02d", &tms.tm_year, &tms.tm_mon, &tms.tm_mday) != 3
+      || sscanf_s(time.c_str(), "%02d%02d%02d", &tms.tm_hour, &tms.tm_min, &tms.tm_sec) != 3)
+    throw make_error({}, "date/time syntax error");
+  tms.tm_year -= 1900;
+  tms.tm_mon -= 1;
+  tms.tm_wday = 0;
+  tms.tm_yday = 0;
+  tms.tm_isdst = 0;
+  return timegm(&tms);
+}
+
+static auto time_to_strings(time_t val, char date[9], char time[7]) -> void
+{
+  struct tm tms;
+  //gmtime_r(&val, &tms);
+  gmtime_s(&tms, &val);
+  snprintf(date, 9, "%04d%02d%02d", tms.tm_year + 1900, tms.tm_mon + 1, tms.tm_mday);
+  snprintf(time, 7, "%02d%02d%02d", tms.tm_hour, tms.tm_min, tms.tm_sec);
+}
+
+//------------------------------------------------------------------------------
+
+auto odim_h5::release_tag() -> char const*
+{
+	//return ODIM_H5_RELEASE_TAG;
+	return "2.0.0"; // TODO do this properly later, just sidestepping learning cmake 
+}
+
+auto odim_h5::default_odim_version() -> std::pair<int, int>
+{
+  return {default_version_major, default_version_minor};
+}
+
+auto odim_h5::worker_threads() -> size_t
+{
+  return worker_pool_instance().size();
+}
+
+auto odim_h5::set_worker_threads(size_t count) -> void
+{
+  std::lock_guard<std::mutex> lock{pool_mut};
+  pool_instance.reset();
+  pool_instance.reset(new worker_pool{std::max<size_t>(1, count)});
+}
+
+handle::handle(const handle& rhs)
+  : id{rhs.id}
+{
+  if (id > 0)
+    H5Iinc_ref(id);
+}
+
+auto handle::operator=(const handle& rhs) -> handle&
+{
+  if (id == rhs.id)
+    return *this;
+  if (id > 0)
+    H5Idec_ref(id);
+  id = rhs.id;
+  if (id > 0)
+    H5Iinc_ref(id);
+  return *this;
+}
+
+handle::~handle()
+{
+  if (id > 0)
+    H5Idec_ref(id);
+}
+
+error::error(const char* what)
+  : std::runtime_error{what}
+{
+
+}
+
+attribute::attribute(const handle* parent, std::string name, bool existing, const attribute_store* owner)
+  : parent_{parent}
+  , owner_{owner}
+  , name_{std::move(name)}
+  , type_{existing ? data_type::unknown : data_type::uninitialized}
+  , size_{0}
+  , cache_{false}
+{
+
+}
+
+// determine whether the value of the attribute can be served from the cache
+auto attribute::cached() const -> bool
+{
+  return cache_ && type_ != data_type::unknown && type_ != data_type::uninitialized;
+}
+
+// read the value of an existing attribute into the cache
+auto attribute::load() const -> void
+{
+  handle type;
+  auto hnd = open(&type);
+  switch (type_)
+  {
+  case data_type::integer:
+  case data_type::integer_array:
+    ints_.resize(size_);
+    if (size_ > 0 && H5Aread(hnd, H5T_NATIVE_LONG, ints_.data()) < 0)
+      throw make_error(hnd, "attribute read", name_.c_str(), "integer");
+    break;
+  case data_type::real:
+  case data_type::real_array:
+    reals_.resize(size_);
+    if (size_ > 0 && H5Aread(hnd, H5T_NATIVE_DOUBLE, reals_.data()) < 0)
+      throw make_error(hnd, "attribute read", name_.c_str(), "real");
+    break;
+  case data_type::string:
+    {
+      std::unique_ptr<char[]> buf{new char[size_]};
+      if (H5Aread(hnd, type, buf.get()) < 0)
+        throw make_error(hnd, "attribute read", name_.c_str(), "string");
+      str_.assign(buf.get(), size_ - 1);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+auto attribute::type() const -> data_type
+{
+  if (type_ == data_type::unknown)
+    open();
+  return type_;
+}
+
+auto attribute::get_boolean() const -> bool
+{
+  if (type_ == data_type::unknown)
+    open();
+  if (type_ != data_type::boolean)
+    throw make_error(open(), "type mismatch", name_.c_str(), "boolean");
+  return size_ == 5;
+}
+
+auto attribute::get_integer() const -> long
+{
+  if (cached())
+  {
+    if (type_ != data_type::integer)
+      throw make_error(*parent_, "type mismatch", name_.c_str(), "integer");
+    return ints_[0];
+  }
+  auto hnd = open();
+  if (type_ != data_type::integer)
+    throw make_error(hnd, "type mismatch", name_.c_str(), "integer");
+  long val;
+  if (H5Aread(hnd, H5T_NATIVE_LONG, &val) < 0)
+    throw make_error(hnd, "attribute read", name_.c_str(), "integer");
+  return val;
+}
+
+auto attribute::get_real() const -> double
+{
+  if (cached())
+  {
+    if (type_ != data_type::real)
+      throw make_error(*parent_, "type mismatch", name_.c_str(), "real");
+    return reals_[0];
+  }
+  auto hnd = open();
+  if (type_ != data_type::real)
+    throw make_error(hnd, "type mismatch", name_.c_str(), "real");
+  double val;
+  if (H5Aread(hnd, H5T_NATIVE_DOUBLE, &val) < 0)
+    throw make_error(hnd, "attribute read", name_.c_str(), "real");
+  return val;
+}
+
+auto attribute::get_string() const -> std::string
+{
+  if (cached())
+  {
+    if (type_ != data_type::string)
+      throw make_error(*parent_, "type mismatch", name_.c_str(), "string");
+    return str_;
+  }
+
+  handle type;
+
+  auto hnd = open(&type);
+  if (type_ != data_type::string)
+    throw make_error(hnd, "type mismatch", name_.c_str(), "string");
+
+  // use stack allocation for short strings
+  if (size_ < 256)
+  {
+    char* buf = static_cast<char*>(alloca(size_));
+    if (H5Aread(hnd, type, buf) < 0)
+      throw make_error(hnd, "attribute read", name_.c_str(), "string");
+    return {buf, size_ - 1};
+  }
+  else
+  {
+    std::unique_ptr<char[]> buf{new char[size_]};
+    if (H5Aread(hnd, type, buf.get()) < 0)
+      throw make_error(hnd, "attribute read", name_.c_str(), "string");
+    return {buf.get(), size_ - 1};
+  }
+}
+
+auto attribute::get_integer_array() const -> std::vector<long>
+{
+  if (cached())
+  {
+    if (type_ != data_type::integer_array)
+      throw make_error(*parent_, "type mismatch", name_.c_str(), "integer_array");
+    return ints_;
+  }
+  auto hnd = open();
+  if (type_ != data_type::integer_array)
+    throw make_error(hnd, "type mismatch", name_.c_str(), "integer_array");
+  std::vector<long> val(size_);
+  if (H5Aread(hnd, H5T_NATIVE_LONG, &val[0]) < 0)
+    throw make_error(hnd, "attribute read", name_.c_str(), "integer_array");
+  return val;
+}
+
+auto attribute::get_real_array() const -> std::vector<double>
+{
+  if (cached())
+  {
+    if (type_ != data_type::real_array)
+      throw make_error(*parent_, "type mismatch", name_.c_str(), "real_array");
+    return reals_;
+  }
+  auto hnd = open();
+  if (type_ != data_type::real_array)
+    throw make_error(hnd, "type mismatch", name_.c_str(), "real_array");
+  std::vector<double> val(size_);
+  if (H5Aread(hnd, H5T_NATIVE_DOUBLE, &val[0]) < 0)
+    throw make_error(hnd, "attribute read", name_.c_str(), "double_array");
+  return val;
+}
+
+auto attribute::set(bool val) -> void
+{
+  handle type;
+  auto hnd = open_or_create(data_type::boolean, val ? 5 : 6, &type);
+  if (H5Awrite(hnd, type, val ? "True" : "False") < 0)
+    throw make_error(hnd, "attribute write", name_.c_str(), "integer");
+}
+
+auto attribute::set(long val) -> void
+{
+  auto hnd = open_or_create(data_type::integer, 1);
+  if (H5Awrite(hnd, H5T_NATIVE_LONG, &val) < 0)
+    throw make_error(hnd, "attribute write", name_.c_str(), "integer");
+  if (cache_)
+    ints_.assign(1, val);
+}
+
+auto attribute::set(double val) -> void
+{
+  auto hnd = open_or_create(data_type::real, 1);
+  if (H5Awrite(hnd, H5T_NATIVE_DOUBLE, &val) < 0)
+    throw make_error(hnd, "attribute write", name_.c_str(), "real");
+  if (cache_)
+    reals_.assign(1, val);
+}
+
+auto attribute::set(const char* val) -> void
+{
+  handle type;
+  auto hnd = open_or_create(data_type::string, strlen(val) + 1, &type);
+  if (H5Awrite(hnd, type, val) < 0)
+    throw make_error(hnd, "attribute write", name_.c_str(), "string");
+  if (cache_)
+    str_ = val;
+}
+
+auto attribute::set(const std::string& val) -> void
+{
+  handle type;
+  auto hnd = open_or_create(data_type::string, val.size() + 1, &type);
+  if (H5Awrite(hnd, type, val.c_str()) < 0)
+    throw make_error(hnd, "attribute write", name_.c_str(), "string");
+  if (cache_)
+    str_ = val;
+}
+
+auto attribute::set(const std::vector<long>& val) -> void
+{
+  auto hnd = open_or_create(data_type::integer_array, val.size());
+  if (H5Awrite(hnd, H5T_NATIVE_LONG, val.data()) < 0)
+    throw make_error(hnd, "attribute write", name_.c_str(), "integer_array");
+  if (cache_)
+    ints_ = val;
+}
+
+auto attribute::set(const std::vector<double>& val) -> void
+{
+  auto hnd = open_or_create(data_type::real_array, val.size());
+  if (H5Awrite(hnd, H5T_NATIVE_DOUBLE, val.data()) < 0)
+    throw make_error(hnd, "attribute write", name_.c_str(), "real_array");
+  if (cache_)
+    reals_ = val;
+}
+
+// open an existing attribute
+auto attribute::open(handle* type_out) const -> handle
+{
+  // attempt to open the attribute
+  handle hnd{H5Aopen(*parent_, name_.c_str(), H5P_DEFAULT)};
+  if (!hnd)
+    throw make_error(*parent_, "attribute open", name_.c_str());
+
+  // get the size (array elements)
+  handle space{H5Aget_space(hnd)};
+  if (!space)
+    throw make_error(hnd, "get attribute space", name_.c_str());
+  auto hsize = H5Sget_simple_extent_npoints(space);
+  if (hsize < 0)
+    throw make_error(hnd, "get attribute size", name_.c_str());
+  size_ = hsize;
+
+  // determine the type
+  handle type{H5Aget_type(hnd)};
+  if (!type)
+    throw make_error(hnd, "get attribute type", name_.c_str());
+  switch (H5Tget_class(type))
+  {
+  case H5T_INTEGER:
+    type_ = size_ > 1 ? data_type::integer_array : data_type::integer;
+    break;
+  case H5T_FLOAT:
+    type_ = size_ > 1 ? data_type::real_array : data_type::real;
+    break;
+  case H5T_STRING:
+    type_ = data_type::string;
+    size_ = H5Tget_size(type);
+    if (size_ == 5 || size_ == 6)
+    {
+      char buf[6];
+      if (H5Aread(hnd, type, buf) < 0)
+        throw make_error(hnd, "read attribute", name_.c_str());
+      if (strcmp(buf, "True") == 0 || strcmp(buf, "False") == 0)
+        type_ = data_type::boolean;
+    }
+    break;
+  default:
+    type_ = data_type::unknown;
+  }
+
+  // return the type to the caller if needed
+  if (type_out)
+    *type_out = std::move(type);
+
+  return hnd;
+}
+
+auto attribute::open_or_create(data_type type, size_t size, handle* type_out) -> handle
+{
+  // let the owning store discard anything it has derived from the old value
+  if (owner_)
+    owner_->attribute_changed(name_);
+
+  if (type_ != data_type::uninitialized)
+  {
+    // if type is a match, just open as normal
+    if (type_ == type && size_ == size)
+      return open(type_out);
+
+    // typemismatch - delete existing attribute
+    if (type_ != data_type::uninitialized)
+    {
+      if (H5Adelete(*parent_, name_.c_str()) < 0)
+        throw make_error(*parent_, "delete attribute", name_.c_str());
+    }
+  }
+
+  type_ = type;
+  size_ = size;
+
+  // create the new attribute
+  switch (type)
+  {
+  case data_type::boolean:
+    {
+      handle type{H5Tcopy(H5T_C_S1)};
+      if (   !type
+          || H5Tset_size(type, size) < 0
+          || H5Tset_strpad(type, H5T_STR_NULLTERM) < 0)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      handle space{H5Screate(H5S_SCALAR)};
+      handle hnd{H5Acreate(*parent_, name_.c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!hnd)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      if (type_out)
+        *type_out = std::move(type);
+      return hnd;
+    }
+  case data_type::integer:
+    {
+      handle space{H5Screate(H5S_SCALAR)};
+      if (!space)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_STD_I64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!hnd)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      return hnd;
+    }
+  case data_type::real:
+    {
+      handle space{H5Screate(H5S_SCALAR)};
+      if (!space)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!hnd)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      return hnd;
+    }
+  case data_type::string:
+    {
+      handle type{H5Tcopy(H5T_C_S1)};
+      if (   !type
+          || H5Tset_size(type, size) < 0
+          || H5Tset_strpad(type, H5T_STR_NULLTERM) < 0)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      handle space{H5Screate(H5S_SCALAR)};
+      handle hnd{H5Acreate(*parent_, name_.c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!hnd)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      if (type_out)
+        *type_out = std::move(type);
+      return hnd;
+    }
+  case data_type::integer_array:
+    {
+      hsize_t dim = size;
+      handle space{H5Screate_simple(1, &dim, nullptr)};
+      if (!space)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_STD_I64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!hnd)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      return hnd;
+    }
+  case data_type::real_array:
+    {
+      hsize_t dim = size;
+      handle space{H5Screate_simple(1, &dim, nullptr)};
+      if (!space)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!hnd)
+        throw make_error(*parent_, "create attribute", name_.c_str());
+      return hnd;
+    }
+  default:
+    /* unreacable */
+    throw make_error(*parent_, "create attribute", name_.c_str());
+  }
+}
+
+// highest index of each numbered member kind within a group
+struct link_index
+{
+  size_t datasets;  // datasetX groups
+  size_t data;      // dataX groups
+  size_t quality;   // qualityX groups
+};
+
+/* Numbered members whose index exceeds the number of links in their group by
+ * more than this are ignored.  This tolerates gaps in the numbering while
+ * preventing a single malformed name from producing an enormous member count. */
+static constexpr size_t max_link_index_gap = 1024;
+
+// parse the index from a member name of the form <prefix><index>
+static auto parse_link_index(const char* name, const char* prefix, size_t& index) -> bool
+{
+  auto len = strlen(prefix);
+  if (strncmp(name, prefix, len) != 0)
+    return false;
+  name += len;
+  if (*name < '1' || *name > '9')
+    return false;
+  size_t val = 0;
+  for (; *name >= '0' && *name <= '9'; ++name)
+  {
+    // reject indices which do not fit rather than letting them wrap
+    size_t digit = *name - '0';
+    if (val > (std::numeric_limits<size_t>::max() - digit) / 10)
+      return false;
+    val = val * 10 + digit;
+  }
+  if (*name != '\0')
+    return false;
+  index = val;
+  return true;
+}
+
+/* Determine the number of numbered members of a group in a single pass over its
+ * links.  The count for each kind is the highest index present, so that gaps in
+ * the numbering do not cause existing members to be missed or overwritten. */
+static auto index_links(const handle& hnd) -> link_index
+{
+  H5G_info_t info;
+  if (H5Gget_info(hnd, &info) < 0)
+    throw make_error(hnd, "get group info");
+
+  struct op_data
+  {
+    link_index  ret;
+    size_t      limit;
+  };
+  op_data od{{0, 0, 0}, static_cast<size_t>(info.nlinks) + max_link_index_gap};
+  auto op = [](hid_t loc, const char* name, const H5L_info_t* info, void* odata) -> herr_t
+  {
+    auto p = static_cast<op_data*>(odata);
+    size_t i;
+    if (parse_link_index(name, "dataset", i) && i <= p->limit)
+      p->ret.datasets = std::max(p->ret.datasets, i);
+    else if (parse_link_index(name, "data", i) && i <= p->limit)
+      p->ret.data = std::max(p->ret.data, i);
+    else if (parse_link_index(name, "quality", i) && i <= p->limit)
+      p->ret.quality = std::max(p->ret.quality, i);
+    return 0;
+  };
+  hsize_t n = 0;
+  if (H5Literate(hnd, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
+    throw make_error(hnd, "iterate links");
+  return od.ret;
+}
+
+#if H5_VERSION_GE(1,12,0)
+typedef H5O_token_t object_token;
+typedef H5O_info2_t object_info;
+#else
+typedef haddr_t     object_token;
+typedef H5O_info_t  object_info;
+#endif
+
+namespace odim_h5
+{
+  // node of the in-memory structure index (one per datasetX, dataX or qualityX group)
+  struct structure_node
+  {
+    typedef std::vector<std::unique_ptr<structure_node>> children;
+
+    bool                has_group = false;
+    object_token        group;              // the group itself
+    bool                has_layer = false;
+    object_token        layer;              // the 'data' dataset within the group
+    data::data_type     type = data::data_type::unknown;
+    std::vector<size_t> dims;
+    std::string         quantity;           // what/quantity
+    size_t              links = 0;          // number of links in the group
+    children            datasets;           // datasetX members (file level only)
+    children            layers;             // dataX members
+    children            qualities;          // qualityX members
+  };
+}
+
+static auto object_open(const handle& loc, const object_token& token) -> hid_t
+{
+#if H5_VERSION_GE(1,12,0)
+  return H5Oopen_by_token(loc, token);
+#else
+  return H5Oopen_by_addr(loc, token);
+#endif
+}
+
+// locate the index node of a numbered child group (name is the group name format)
+static auto structure_child(const structure_node* node, const char* name, size_t index) -> const structure_node*
+{
+  if (!node)
+    return nullptr;
+  const structure_node::children* list = nullptr;
+  if (strcmp(name, "dataset%zu") == 0)
+    list = &node->datasets;
+  else if (strcmp(name, "data%zu") == 0)
+    list = &node->layers;
+  else if (strcmp(name, "quality%zu") == 0)
+    list = &node->qualities;
+  if (!list || index >= list->size() || !(*list)[index] || !(*list)[index]->has_group)
+    return nullptr;
+  return (*list)[index].get();
+}
+
+static inline auto group_checked_open_or_create(
+      const handle& parent
+    , const structure_node* node
+    , const char* name
+    , size_t index
+    , bool open
+    ) -> handle::id_t
+{
+  char buf[32];
+  sprintf_s(buf, name, index + 1);
+  auto child = open ? structure_child(node, name, index) : nullptr;
+  auto ret = child
+    ? object_open(parent, child->group)
+    : open
+    ? H5Gopen(parent, buf, H5P_DEFAULT) 
+    : H5Gcreate(parent, buf, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if (ret < 0)
+    throw make_error(parent, "group open", buf);
+  return ret;
+}
+
+attribute_store::attribute_store(handle::id_t hnd, bool existing, load_policy policy)
+  : hnd_{hnd}
+  , loaded_{!existing}
+  , policy_{policy}
+  , node_{nullptr}
+{
+  if (existing && policy_ != load_policy::deferred)
+    load();
+}
+
+// open the what, where and how groups and enumerate their attributes
+auto attribute_store::load() const -> void
+{
+  if (H5Lexists(hnd_, "what", H5P_DEFAULT) > 0)
+    what_ = H5Gopen(hnd_, "what", H5P_DEFAULT);
+  if (H5Lexists(hnd_, "where", H5P_DEFAULT) > 0)
+    where_ = H5Gopen(hnd_, "where", H5P_DEFAULT);
+  if (H5Lexists(hnd_, "how", H5P_DEFAULT) > 0)
+    how_ = H5Gopen(hnd_, "how", H5P_DEFAULT);
+
+  hsize_t n = 0;
+  H5O_info_t info;
+
+  // determine the number of attributes available and reserve space in the vector
+  if (what_ && H5Oget_info(what_, &info, H5O_INFO_BASIC) >= 0) // interface change? https://stackoverflow.com/questions/62157364/why-is-hdf5-giving-a-too-few-arguments-error-here
+    n += info.num_attrs;
+  if (where_ && H5Oget_info(where_, &info, H5O_INFO_BASIC) >= 0)
+    n += info.num_attrs;
+  if (how_ && H5Oget_info(how_, &info, H5O_INFO_BASIC) >= 0)
+    n += info.num_attrs;
+  attrs_.reserve(n);
+
+  // define operation needed to iterate through attribute
+  struct op_data
+  {
+    const attribute_store& store;
+    handle* hnd;
+  };
+  op_data od{*this, nullptr};
+  auto op = [](hid_t loc, const char* name, const H5A_info_t* info, void* odata) -> herr_t
+  {
+    auto p = reinterpret_cast<op_data*>(odata);
+    p->store.attrs_.push_back({p->hnd, name, true, &p->store});
+    if (p->store.policy_ == load_policy::snapshot)
+    {
+      auto& a = p->store.attrs_.back();
+      a.cache_ = true;
+      a.load();
+    }
+    return 0;
+  };
+
+  // iterate through each group to fetch the attribute names (and values for a snapshot)
+  n = 0; od.hnd = &what_;
+  if (what_ && H5Aiterate(what_, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
+    throw make_error(hnd_, "iterate attributes", "what");
+  n = 0; od.hnd = &where_;
+  if (where_ && H5Aiterate(where_, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
+    throw make_error(hnd_, "iterate attributes", "where");
+  n = 0; od.hnd = &how_;
+  if (how_ && H5Aiterate(how_, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
+    throw make_error(hnd_, "iterate attributes", "how");
+
+  index_build();
+  loaded_ = true;
+}
+
+attribute_store::attribute_store(
+      const attribute_store& parent
+    , const char* name
+    , size_t index
+    , bool existing)
+  : attribute_store{group_checked_open_or_create(parent.hnd_, parent.node_, name, index, existing), existing, parent.policy_}
+{
+  if (existing && parent.node_)
+  {
+    structure_ = parent.structure_;
+    node_ = structure_child(parent.node_, name, index);
+  }
+
+}
+
+attribute_store::attribute_store(const attribute_store& rhs)
+  : hnd_{rhs.hnd_}
+  , what_{rhs.what_}
+  , where_{rhs.where_}
+  , how_{rhs.how_}
+  , attrs_(rhs.attrs_)
+  , index_(rhs.index_)
+  , loaded_{rhs.loaded_}
+  , policy_{rhs.policy_}
+  , structure_{rhs.structure_}
+  , node_{rhs.node_}
+{
+  fix_attribute_parents(rhs);
+}
+
+attribute_store::attribute_store(attribute_store&& rhs) noexcept
+  : hnd_{std::move(rhs.hnd_)}
+  , what_{std::move(rhs.what_)}
+  , where_{std::move(rhs.where_)}
+  , how_{std::move(rhs.how_)}
+  , attrs_(std::move(rhs.attrs_))
+  , index_(std::move(rhs.index_))
+  , loaded_{rhs.loaded_}
+  , policy_{rhs.policy_}
+  , structure_{std::move(rhs.structure_)}
+  , node_{rhs.node_}
+{
+  fix_attribute_parents(rhs);
+}
+
+auto attribute_store::operator=(const attribute_store& rhs) -> attribute_store&
+{
+  hnd_ = rhs.hnd_;
+  what_ = rhs.what_;
+  where_ = rhs.where_;
+  how_ = rhs.how_;
+  attrs_ = rhs.attrs_;
+  index_ = rhs.index_;
+  loaded_ = rhs.loaded_;
+  policy_ = rhs.policy_;
+  structure_ = rhs.structure_;
+  node_ = rhs.node_;
+  fix_attribute_parents(rhs);
+  return *this;
+}
+
+auto attribute_store::operator=(attribute_store&& rhs) noexcept -> attribute_store&
+{
+  hnd_ = std::move(rhs.hnd_);
+  what_ = std::move(rhs.what_);
+  where_ = std::move(rhs.where_);
+  how_ = std::move(rhs.how_);
+  attrs_ = std::move(rhs.attrs_);
+  index_ = std::move(rhs.index_);
+  loaded_ = rhs.loaded_;
+  policy_ = rhs.policy_;
+  structure_ = std::move(rhs.structure_);
+  node_ = rhs.node_;
+  fix_attribute_parents(rhs);
+  return *this;
+}
+
+auto attribute_store::fix_attribute_parents(const attribute_store& old) -> void
+{
+  // update the 'parent group' and owning store pointers for each attribute
+  for (auto& a : attrs_)
+  {
+    a.owner_ = this;
+    if (a.parent_ == &old.what_)
+      a.parent_ = &what_;
+    else if (a.parent_ == &old.where_)
+      a.parent_ = &where_;
+    else
+      a.parent_ = &how_;
+  }
+}
+
+// find the position of the named attribute in attrs_, or attrs_.size() if not found
+auto attribute_store::index_find(const char* name) const noexcept -> size_t
+{
+  auto i = std::lower_bound(index_.begin(), index_.end(), name, [this](size_t pos, const char* name)
+  {
+    return strcmp(attrs_[pos].name_.c_str(), name) < 0;
+  });
+  return i != index_.end() && attrs_[*i].name_ == name ? *i : attrs_.size();
+}
+
+// rebuild the index over every attribute in the store
+auto attribute_store::index_build() const -> void
+{
+  index_.resize(attrs_.size());
+  for (size_t i = 0; i < index_.size(); ++i)
+    index_[i] = i;
+  // stable so that duplicate names resolve to the first in file order
+  std::stable_sort(index_.begin(), index_.end(), [this](size_t lhs, size_t rhs)
+  {
+    return attrs_[lhs].name_ < attrs_[rhs].name_;
+  });
+}
+
+// add the attribute at position pos in attrs_ to the index, after any existing entries of the same name
+auto attribute_store::index_insert(size_t pos) -> void
+{
+  auto& name = attrs_[pos].name_;
+  auto i = std::upper_bound(index_.begin(), index_.end(), pos, [this, &name](size_t, size_t rhs)
+  {
+    return name < attrs_[rhs].name_;
+  });
+  index_.insert(i, pos);
+}
+
+// remove the attribute at position pos in attrs_ from the index
+auto attribute_store::index_erase(size_t pos) -> void
+{
+  index_.erase(std::remove(index_.begin(), index_.end(), pos), index_.end());
+  for (auto& i : index_)
+    if (i > pos)
+      --i;
+}
+
+auto attribute_store::find(const char* name) -> iterator
+{
+  ensure_loaded();
+  return attrs_.begin() + index_find(name);
+}
+
+auto attribute_store::find(const char* name) const -> const_iterator
+{
+  ensure_loaded();
+  return attrs_.begin() + index_find(name);
+}
+
+auto attribute_store::find(const std::string& name) -> iterator
+{
+  ensure_loaded();
+  return attrs_.begin() + index_find(name.c_str());
+}
+
+auto attribute_store::find(const std::string& name) const -> const_iterator
+{
+  ensure_loaded();
+  return attrs_.begin() + index_find(name.c_str());
+}
+
+auto attribute_store::operator[](const char* name) -> attribute&
+{
+  ensure_loaded();
+  auto pos = index_find(name);
+  if (pos != attrs_.size())
+    return attrs_[pos];
+
+  // okay, need to insert it
+  if (is_what_attribute(name))
+  {
+    if (!what_)
+    {
+      what_ = handle{H5Gcreate(hnd_, "what", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!what_)
+        throw make_error(hnd_, "create group", "what");
+    }
+    attrs_.push_back({&what_, name, false, this});
+  }
+  else if (is_where_attribute(name))
+  {
+    if (!where_)
+    {
+      where_ = handle{H5Gcreate(hnd_, "where", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!where_)
+        throw make_error(hnd_, "create group", "where");
+    }
+    attrs_.push_back({&where_, name, false, this});
+  }
+  else
+  {
+    if (!how_)
+    {
+      how_ = handle{H5Gcreate(hnd_, "how", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!how_)
+        throw make_error(hnd_, "create group", "how");
+    }
+    attrs_.push_back({&how_, name, false, this});
+  }
+  attrs_.back().cache_ = policy_ == load_policy::snapshot;
+  index_insert(attrs_.size() - 1);
+  return attrs_.back();
+}
+
+auto attribute_store::operator[](const char* name) const -> const attribute&
+{
+  ensure_loaded();
+  auto pos = index_find(name);
+  if (pos != attrs_.size())
+    return attrs_[pos];
+  throw make_error(hnd_, "no such attribute", name);
+}
+
+auto attribute_store::erase(iterator i) -> void
+{
+  // remove the attribute from the file
+  if (i->type_ != attribute::data_type::uninitialized)
+  {
+    if (H5Adelete(*i->parent_, i->name().c_str()) < 0)
+      throw make_error(hnd_, "attribute delete", i->name().c_str());
+  }
+  
+  // now remove it from the store
+  attribute_changed(i->name_);
+  index_erase(i - attrs_.begin());
+  attrs_.erase(i);
+}
+
+auto attribute_store::erase(const std::string& name) -> void
+{
+  auto i = find(name);
+  if (i != attrs_.end())
+    erase(i);
+}
+
+auto attribute_store::attribute_changed(const std::string& name) const noexcept -> void
+{
+
+}
+
+group::group(handle::id_t hnd, bool existing, load_policy policy)
+  : attribute_store{hnd, existing, policy}
+{
+
+}
+
+group::group(const attribute_store& parent, const char* name, size_t index, bool existing)
+  : attribute_store{parent, name, index, existing}
+{
+
+}
+
+group::~group()
+{
+
+}
+
+auto group::is_api_attribute(const std::string& name) const -> bool
+{
+  return false;
+}
+
+data::data(const attribute_store& parent, bool quality, size_t index)
+  : group{parent, quality ? "quality%zu" : "data%zu", index, true}
+  , size_quality_{0}
+  , data_{node_ && node_->has_layer ? object_open(hnd_, node_->layer) : H5Dopen(hnd_, "data", H5P_DEFAULT)}
+  , cached_{0}
+{
+  if (!data_)
+    throw make_error(hnd_, "open dataset", "data");
+
+  // use the structure index if available
+  if (node_ && node_->has_layer)
+  {
+    type_ = node_->type;
+    dims_ = node_->dims;
+    size_ = 1;
+    for (auto d : dims_)
+      size_ *= d;
+    size_quality_ = node_->qualities.size();
+    return;
+  }
+
+  load_shape();
+
+  // determine the number of qualityX layers
+  size_quality_ = index_links(hnd_).quality;
+}
+
+data::data(
+      const attribute_store& parent
+    , bool quality
+    , size_t index
+    , data_type type
+    , size_t rank
+    , const size_t* dims
+    , const compression_options& compression
+    , const layout& storage)
+  : group{parent, quality ? "quality%zu" : "data%zu", index, false}
+  , size_quality_{0}
+  , type_{type}
+  , dims_(dims, dims + rank)
+  , size_{1}
+  , cached_{0}
+{
+  // convert dimension array to hdf size type
+  hsize_t hdims[max_rank];
+  for (size_t i = 0; i < rank; ++i)
+    hdims[i] = dims[i];
+
+  // resolve an automatic layout policy into a concrete one
+  const bool compressed = compression.type() != compression_options::codec::none;
+  auto strategy = storage.strategy_;
+  size_t rays = storage.rays_;
+  if (strategy == layout::strategy::automatic)
+  {
+    size_t row = storage_type_size(type);
+    for (size_t i = 1; i < rank; ++i)
+      row *= dims[i];
+    size_t bytes = rank > 0 ? row * dims[0] : 0;
+
+    if (!compressed && bytes <= auto_compact_limit)
+      strategy = layout::strategy::compact;
+    else if (!compressed && bytes <= auto_chunk_size)
+      strategy = layout::strategy::contiguous;
+    else
+    {
+      strategy = layout::strategy::chunk_rays;
+      rays = row > 0 ? auto_chunk_size / row : 0;
+    }
+  }
+
+  // determine the chunk shape
+  hsize_t hchunk[max_rank];
+  if (strategy == layout::strategy::chunk_shape)
+  {
+    if (storage.chunk_.size() != rank)
+      throw make_error(hnd_, "create dataset", nullptr, "chunk shape rank mismatch");
+    for (size_t i = 0; i < rank; ++i)
+      hchunk[i] = std::max<hsize_t>(1, std::min<hsize_t>(storage.chunk_[i], hdims[i]));
+  }
+  else if (strategy == layout::strategy::chunk_rays)
+  {
+    for (size_t i = 0; i < rank; ++i)
+      hchunk[i] = std::max<hsize_t>(1, hdims[i]);
+    if (rank > 0)
+      hchunk[0] = std::max<hsize_t>(1, std::min<hsize_t>(rays, hdims[0]));
+  }
+
+  // create the dataset
+  handle space{H5Screate_simple(rank, hdims, hdims)};
+  if (!space)
+    throw make_error(hnd_, "create dataset");
+  handle plist{H5Pcreate(H5P_DATASET_CREATE)};
+  if (!plist)
+    throw make_error(hnd_, "create dataset");
+  switch (strategy)
+  {
+  case layout::strategy::contiguous:
+  case layout::strategy::compact:
+    if (compressed)
+      throw make_error(hnd_, "create dataset", nullptr, "layout does not support compression");
+    if (H5Pset_layout(plist, strategy == layout::strategy::compact ? H5D_COMPACT : H5D_CONTIGUOUS) < 0)
+      throw make_error(hnd_, "create dataset");
+    break;
+  default:
+    if (H5Pset_chunk(plist, rank, hchunk) < 0)
+      throw make_error(hnd_, "create dataset");
+    set_compression(hnd_, plist, compression);
+    break;
+  }
+  data_ = H5Dcreate(hnd_, "data", hdf_storage_type(type), space, H5P_DEFAULT, plist, H5P_DEFAULT);
+  if (!data_)
+    throw make_error(hnd_, "create dataset");
+  for (auto d : dims_)
+    size_ *= d;
+
+  // if 2d, add the image attributes (for sake of hdfview)
+  if (rank == 2)
+  {
+    attribute{&data_, "CLASS", false}.set("IMAGE");
+    attribute{&data_, "IMAGE_VERSION", false}.set("1.2");
+  }
+}
+
+auto data::compression_options::none() -> compression_options
+{
+  return {codec::none, 0, false};
+}
+
+auto data::compression_options::deflate(int level, bool shuffle) -> compression_options
+{
+  return {codec::deflate, level, shuffle};
+}
+
+auto data::compression_options::lz4(bool shuffle) -> compression_options
+{
+  return {codec::lz4, 0, shuffle};
+}
+
+auto data::compression_options::zstd(int level, bool shuffle) -> compression_options
+{
+  return {codec::zstd, level, shuffle};
+}
+
+auto data::compression_options::available(codec type) -> bool
+{
+  return type == codec::none || filter_encode_available(codec_filter(type));
+}
+
+auto data::layout::automatic() -> layout
+{
+  return {};
+}
+
+auto data::layout::chunked(size_t rank, const size_t* dims) -> layout
+{
+  layout ret;
+  ret.strategy_ = strategy::chunk_shape;
+  ret.chunk_.assign(dims, dims + rank);
+  return ret;
+}
+
+auto data::layout::rays(size_t count) -> layout
+{
+  if (count == 0)
+    throw make_error({}, "layout", nullptr, "chunk ray count must be positive");
+  layout ret;
+  ret.strategy_ = strategy::chunk_rays;
+  ret.rays_ = count;
+  return ret;
+}
+
+auto data::layout::contiguous() -> layout
+{
+  layout ret;
+  ret.strategy_ = strategy::contiguous;
+  return ret;
+}
+
+auto data::layout::compact() -> layout
+{
+  layout ret;
+  ret.strategy_ = strategy::compact;
+  return ret;
+}
+
+auto data::quality_open(size_t i) const -> data
+{
+  return {*this, true, i};
+}
+
+auto data::quality_append(
+      data_type type
+    , size_t rank
+    , const size_t* dims
+    , const compression_options& compression
+    , const layout& storage
+    ) -> data
+{
+  return {*this, true, size_quality_++, type, rank, dims, compression, storage};
+}
+
+// flags used to track the cached packing parameters of a data layer
+static constexpr unsigned int cache_gain = 1;
+static constexpr unsigned int cache_offset = 2;
+static constexpr unsigned int cache_nodata = 4;
+static constexpr unsigned int cache_undetect = 8;
+
+// determine the storage type of a dataset
+static auto dataset_storage_type(const handle& hnd, const handle& dset) -> data::data_type
+{
+  handle id{H5Dget_type(dset)};
+  if (!id)
+    throw make_error(hnd, "get dataset type");
+
+  auto type = H5Tget_class(id);
+  auto size = H5Tget_size(id);
+
+  if (type == H5T_INTEGER)
+  {
+    auto sign = H5Tget_sign(id) == H5T_SGN_2;
+    switch (size)
+    {
+    case 1:
+      return sign ? data::data_type::i8 : data::data_type::u8;
+    case 2:
+      return sign ? data::data_type::i16 : data::data_type::u16;
+    case 4:
+      return sign ? data::data_type::i32 : data::data_type::u32;
+    case 8:
+      return sign ? data::data_type::i64 : data::data_type::u64;
+    }
+  }
+  else if (type == H5T_FLOAT)
+  {
+    switch (size)
+    {
+    case 4:
+      return data::data_type::f32;
+    case 8:
+      return data::data_type::f64;
+    }
+  }
+
+  return data::data_type::unknown;
+}
+
+// cache the storage type and shape of the dataset (these are fixed once created)
+auto data::load_shape() -> void
+{
+  type_ = dataset_storage_type(hnd_, data_);
+
+  handle space{H5Dget_space(data_)};
+  if (!space)
+    throw make_error(hnd_, "get dataset dims");
+  hsize_t dims[H5S_MAX_RANK];
+  auto rank = H5Sget_simple_extent_dims(space, dims, nullptr);
+  if (rank < 0)
+    throw make_error(hnd_, "get dataset dims");
+  dims_.assign(dims, dims + rank);
+  size_ = 1;
+  for (auto d : dims_)
+    size_ *= d;
+}
+
+auto data::cached_real(unsigned int flag, double& val, const char* name) const -> double
+{
+  if (!(cached_ & flag))
+  {
+    val = attributes()[name].get_real();
+    cached_ |= flag;
   }
+  return val;
+}
+
+auto data::store_real(unsigned int flag, double& val, const char* name, double set) -> void
+{
+  attribute_store::operator[](name).set(set);
+  val = set;
+  cached_ |= flag;
+}
+
+// discard the cached packing parameter when its attribute is written or erased
+auto data::attribute_changed(const std::string& name) const noexcept -> void
+{
+  if (name == "gain")
+    cached_ &= ~cache_gain;
+  else if (name == "offset")
+    cached_ &= ~cache_offset;
+  else if (name == "nodata")
+    cached_ &= ~cache_nodata;
+  else if (name == "undetect")
+    cached_ &= ~cache_undetect;
+}
+
+auto data::dims(size_t* val) const -> size_t
+{
+  std::copy(dims_.begin(), dims_.end(), val);
+  return dims_.size();
+}
+
+auto data::quantity() const -> std::string
+{
+  return attributes()["quantity"].get_string();
+}
+
+auto data::set_quantity(const std::string& val) -> void
+{
+  attributes()["quantity"].set(val);
+}
+
+auto data::gain() const -> double
+{
+  return cached_real(cache_gain, gain_, "gain");
+}
+
+auto data::set_gain(double val) -> void
+{
+  store_real(cache_gain, gain_, "gain", val);
+}
+
+auto data::offset() const -> double
+{
+  return cached_real(cache_offset, offset_, "offset");
+}
+
+auto data::set_offset(double val) -> void
+{
+  store_real(cache_offset, offset_, "offset", val);
+}
+
+auto data::nodata() const -> double
+{
+  return cached_real(cache_nodata, nodata_, "nodata");
+}
+
+auto data::set_nodata(double val) -> void
+{
+  store_real(cache_nodata, nodata_, "nodata", val);
 }
 
-static inline auto group_checked_open_or_create(
-      const handle& parent
-    , const char* name
-    , size_t index
-    , bool open
-    ) -> handle::id_t
+auto data::undetect() const -> double
 {
-  char buf[32];
-  sprintf_s(buf, name, index + 1);
-  auto ret = open 
-    ? H5Gopen(parent, buf, H5P_DEFAULT) 
-    : H5Gcreate(parent, buf, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-  if (ret < 0)
-    throw make_error(parent, "group open", buf);
-  return ret;
+  return cached_real(cache_undetect, undetect_, "undetect");
 }
 
-attribute_store::attribute_store(handle::id_t hnd, bool existing)
-  : hnd_{hnd}
+auto data::set_undetect(double val) -> void
 {
-  if (existing)
-  {
-    if (H5Lexists(hnd_, "what", H5P_DEFAULT) > 0)
-      what_ = H5Gopen(hnd_, "what", H5P_DEFAULT);
-    if (H5Lexists(hnd_, "where", H5P_DEFAULT) > 0)
-      where_ = H5Gopen(hnd_, "where", H5P_DEFAULT);
-    if (H5Lexists(hnd_, "how", H5P_DEFAULT) > 0)
-      how_ = H5Gopen(hnd_, "how", H5P_DEFAULT);
-
-    hsize_t n = 0;
-    H5O_info_t info;
-
-    // determine the number of attributes available and reserve space in the vector
-    if (what_ && H5Oget_info(what_, &info, H5O_INFO_BASIC) >= 0) // interface change? https://stackoverflow.com/questions/62157364/why-is-hdf5-giving-a-too-few-arguments-error-here
-      n += info.num_attrs;
-    if (where_ && H5Oget_info(where_, &info, H5O_INFO_BASIC) >= 0)
-      n += info.num_attrs;
-    if (how_ && H5Oget_info(how_, &info, H5O_INFO_BASIC) >= 0)
-      n += info.num_attrs;
-    attrs_.reserve(n);
-
-    // define operation needed to iterate through attribute
-    struct op_data
-    {
-      attribute_store& store;
-      handle* hnd;
-    };
-    op_data od{*this, nullptr};
-    auto op = [](hid_t loc, const char* name, const H5A_info_t* info, void* odata) -> herr_t
-    {
-      auto p = reinterpret_cast<op_data*>(odata);
-      p->store.attrs_.push_back({p->hnd, name, true});
-      return 0;
-    };
+  store_real(cache_undetect, undetect_, "undetect", val);
+}
 
-    // iterate through each group to fetch the attribute names
-    n = 0; od.hnd = &what_;
-    if (what_ && H5Aiterate(what_, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
-      throw make_error(hnd_, "iterate attributes", "what");
-    n = 0; od.hnd = &where_;
-    if (where_ && H5Aiterate(where_, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
-      throw make_error(hnd_, "iterate attributes", "where");
-    n = 0; od.hnd = &how_;
-    if (how_ && H5Aiterate(how_, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
-      throw make_error(hnd_, "iterate attributes", "how");
-  }
+auto data::is_api_attribute(const std::string& name) const -> bool
+{
+  return 
+       name == "quantity"
+    || name == "gain"
+    || name == "offset"
+    || name == "nodata"
+    || name == "undetect"
+    || group::is_api_attribute(name);
 }
 
-attribute_store::attribute_store(
-      const handle& parent
-    , const char* name
-    , size_t index
-    , bool existing)
-  : attribute_store{group_checked_open_or_create(parent, name, index, existing), existing}
+template <typename T>
+auto data::read(T* data) const -> void
 {
+  auto err = H5Dread(data_, hdf_native_type<T>(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+  if (err < 0)
+    throw make_error(hnd_, "read dataset", "data", err);
+}
+
+template auto data::read<char>(char* data) const -> void;
+template auto data::read<signed char>(signed char* data) const -> void;
+template auto data::read<unsigned char>(unsigned char* data) const -> void;
+template auto data::read<short>(short* data) const -> void;
+template auto data::read<unsigned short>(unsigned short* data) const -> void;
+template auto data::read<int>(int* data) const -> void;
+template auto data::read<unsigned int>(unsigned int* data) const -> void;
+template auto data::read<long>(long* data) const -> void;
+template auto data::read<unsigned long>(unsigned long* data) const -> void;
+template auto data::read<long long>(long long* data) const -> void;
+template auto data::read<unsigned long long>(unsigned long long* data) const -> void;
+template auto data::read<float>(float* data) const -> void;
+template auto data::read<double>(double* data) const -> void;
+template auto data::read<long double>(long double* data) const -> void;
+
+// select a hyperslab in the file space of a dataset and build the matching memory space
+static auto select_hyperslab(
+      const handle& hnd
+    , const handle& dset
+    , const size_t* start
+    , const size_t* count
+    , const size_t* stride
+    , handle& fspace
+    , handle& mspace
+    ) -> void
+{
+  fspace = handle{H5Dget_space(dset)};
+  if (!fspace)
+    throw make_error(hnd, "get dataset space", "data");
+  auto rank = H5Sget_simple_extent_ndims(fspace);
+  if (rank < 0)
+    throw make_error(hnd, "get dataset rank", "data");
+
+  hsize_t hstart[H5S_MAX_RANK], hcount[H5S_MAX_RANK], hstride[H5S_MAX_RANK];
+  for (int i = 0; i < rank; ++i)
+  {
+    hstart[i] = start[i];
+    hcount[i] = count[i];
+    hstride[i] = stride ? stride[i] : 1;
+  }
 
+  if (H5Sselect_hyperslab(fspace, H5S_SELECT_SET, hstart, hstride, hcount, nullptr) < 0)
+    throw make_error(hnd, "select hyperslab", "data");
+  if (H5Sselect_valid(fspace) <= 0)
+    throw make_error(hnd, "select hyperslab", "data", "selection out of bounds");
+
+  mspace = handle{H5Screate_simple(rank, hcount, nullptr)};
+  if (!mspace)
+    throw make_error(hnd, "create memory space", "data");
 }
 
-attribute_store::attribute_store(const attribute_store& rhs)
-  : hnd_{rhs.hnd_}
-  , what_{rhs.what_}
-  , where_{rhs.where_}
-  , how_{rhs.how_}
-  , attrs_(rhs.attrs_)
+template <typename T>
+auto data::read(T* data, const size_t* start, const size_t* count, const size_t* stride) const -> void
 {
-  fix_attribute_parents(rhs);
+  handle fspace, mspace;
+  select_hyperslab(hnd_, data_, start, count, stride, fspace, mspace);
+  auto err = H5Dread(data_, hdf_native_type<T>(), mspace, fspace, H5P_DEFAULT, data);
+  if (err < 0)
+    throw make_error(hnd_, "read dataset", "data", err);
 }
 
-attribute_store::attribute_store(attribute_store&& rhs) noexcept
-  : hnd_{std::move(rhs.hnd_)}
-  , what_{std::move(rhs.what_)}
-  , where_{std::move(rhs.where_)}
-  , how_{std::move(rhs.how_)}
-  , attrs_(std::move(rhs.attrs_))
+template auto data::read<char>(char* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<signed char>(signed char* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<unsigned char>(unsigned char* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<short>(short* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<unsigned short>(unsigned short* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<int>(int* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<unsigned int>(unsigned int* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<long>(long* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<unsigned long>(unsigned long* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<long long>(long long* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<unsigned long long>(unsigned long long* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<float>(float* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<double>(double* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read<long double>(long double* data, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+
+auto data::read_native(
+      data_type type
+    , void* buf
+    , const size_t* start
+    , const size_t* count
+    , const size_t* stride
+    ) const -> void
+{
+  herr_t err;
+  if (start)
+  {
+    handle fspace, mspace;
+    select_hyperslab(hnd_, data_, start, count, stride, fspace, mspace);
+    err = H5Dread(data_, hdf_memory_type(type), mspace, fspace, H5P_DEFAULT, buf);
+  }
+  else
+    err = H5Dread(data_, hdf_memory_type(type), H5S_ALL, H5S_ALL, H5P_DEFAULT, buf);
+  if (err < 0)
+    throw make_error(hnd_, "read dataset", "data", err);
+}
+
+template <typename T>
+auto data::read_unpack(T* data, T undetect, T nodata) const -> void
 {
-  fix_attribute_parents(rhs);
+  read_unpack(data, undetect, nodata, nullptr, nullptr, nullptr);
 }
 
-auto attribute_store::operator=(const attribute_store& rhs) -> attribute_store&
+template <typename T>
+auto data::read_unpack(
+      T* data
+    , T undetect
+    , T nodata
+    , const size_t* start
+    , const size_t* count
+    , const size_t* stride
+    ) const -> void
+{
+  const auto type = this->type();
+  auto kernel = unpack_kernel_for<T>(type);
+  if (!kernel)
+    throw make_error(hnd_, "read dataset", "data", "unsupported storage type");
+
+  size_t size = 1;
+  if (start)
+  {
+    const auto rank = this->rank();
+    for (size_t i = 0; i < rank; ++i)
+      size *= count[i];
+  }
+  else
+    size = this->size();
+
+  const unpack_params<T> params{gain(), offset(), this->nodata(), this->undetect(), nodata, undetect};
+
+  // if the user type matches the storage type we can unpack in place
+  if (H5Tequal(hdf_native_type<T>(), hdf_memory_type(type)) > 0)
+  {
+    read_native(type, data, start, count, stride);
+    kernel(data, data, size, params);
+  }
+  else
+  {
+    std::unique_ptr<unsigned char[]> buf{new unsigned char[size * storage_type_size(type)]};
+    read_native(type, buf.get(), start, count, stride);
+    kernel(buf.get(), data, size, params);
+  }
+}
+
+template auto data::read_unpack<char>(char* data, char undetect, char nodata) const -> void;
+template auto data::read_unpack<signed char>(signed char* data, signed char undetect, signed char nodata) const -> void;
+template auto data::read_unpack<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata) const -> void;
+template auto data::read_unpack<short>(short* data, short undetect, short nodata) const -> void;
+template auto data::read_unpack<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata) const -> void;
+template auto data::read_unpack<int>(int* data, int undetect, int nodata) const -> void;
+template auto data::read_unpack<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata) const -> void;
+template auto data::read_unpack<long>(long* data, long undetect, long nodata) const -> void;
+template auto data::read_unpack<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata) const -> void;
+template auto data::read_unpack<long long>(long long* data, long long undetect, long long nodata) const -> void;
+template auto data::read_unpack<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata) const -> void;
+template auto data::read_unpack<float>(float* data, float undetect, float nodata) const -> void;
+template auto data::read_unpack<double>(double* data, double undetect, double nodata) const -> void;
+template auto data::read_unpack<long double>(long double* data, long double undetect, long double nodata) const -> void;
+template auto data::read_unpack<char>(char* data, char undetect, char nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<signed char>(signed char* data, signed char undetect, signed char nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<short>(short* data, short undetect, short nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<int>(int* data, int undetect, int nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<long>(long* data, long undetect, long nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<long long>(long long* data, long long undetect, long long nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<float>(float* data, float undetect, float nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<double>(double* data, double undetect, double nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+template auto data::read_unpack<long double>(long double* data, long double undetect, long double nodata, const size_t* start, const size_t* count, const size_t* stride) const -> void;
+
+template <typename T>
+auto data::read_parallel(T* data) const -> void
 {
-  hnd_ = rhs.hnd_;
-  what_ = rhs.what_;
-  where_ = rhs.where_;
-  how_ = rhs.how_;
-  attrs_ = rhs.attrs_;
-  fix_attribute_parents(rhs);
-  return *this;
+  const auto type = this->type();
+  raw_layer layer;
+  if (   !raw_layer_open(hnd_, data_, type, layer)
+      || !raw_layer_read(hnd_, data_, layer, data, convert_kernel_for<T>(type), unpack_params<T>{}))
+    read(data);
 }
 
-auto attribute_store::operator=(attribute_store&& rhs) noexcept -> attribute_store&
+template <typename T>
+auto data::read_unpack_parallel(T* data, T undetect, T nodata) const -> void
 {
-  hnd_ = std::move(rhs.hnd_);
-  what_ = std::move(rhs.what_);
-  where_ = std::move(rhs.where_);
-  how_ = std::move(rhs.how_);
-  attrs_ = std::move(rhs.attrs_);
-  fix_attribute_parents(rhs);
-  return *this;
+  const auto type = this->type();
+  raw_layer layer;
+  if (!raw_layer_open(hnd_, data_, type, layer))
+  {
+    read_unpack(data, undetect, nodata);
+    return;
+  }
+
+  const unpack_params<T> params{gain(), offset(), this->nodata(), this->undetect(), nodata, undetect};
+  if (!raw_layer_read(hnd_, data_, layer, data, unpack_kernel_for<T>(type), params))
+    read_unpack(data, undetect, nodata);
+}
+
+template auto data::read_parallel<char>(char* data) const -> void;
+template auto data::read_parallel<signed char>(signed char* data) const -> void;
+template auto data::read_parallel<unsigned char>(unsigned char* data) const -> void;
+template auto data::read_parallel<short>(short* data) const -> void;
+template auto data::read_parallel<unsigned short>(unsigned short* data) const -> void;
+template auto data::read_parallel<int>(int* data) const -> void;
+template auto data::read_parallel<unsigned int>(unsigned int* data) const -> void;
+template auto data::read_parallel<long>(long* data) const -> void;
+template auto data::read_parallel<unsigned long>(unsigned long* data) const -> void;
+template auto data::read_parallel<long long>(long long* data) const -> void;
+template auto data::read_parallel<unsigned long long>(unsigned long long* data) const -> void;
+template auto data::read_parallel<float>(float* data) const -> void;
+template auto data::read_parallel<double>(double* data) const -> void;
+template auto data::read_parallel<long double>(long double* data) const -> void;
+
+template auto data::read_unpack_parallel<char>(char* data, char undetect, char nodata) const -> void;
+template auto data::read_unpack_parallel<signed char>(signed char* data, signed char undetect, signed char nodata) const -> void;
+template auto data::read_unpack_parallel<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata) const -> void;
+template auto data::read_unpack_parallel<short>(short* data, short undetect, short nodata) const -> void;
+template auto data::read_unpack_parallel<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata) const -> void;
+template auto data::read_unpack_parallel<int>(int* data, int undetect, int nodata) const -> void;
+template auto data::read_unpack_parallel<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata) const -> void;
+template auto data::read_unpack_parallel<long>(long* data, long undetect, long nodata) const -> void;
+template auto data::read_unpack_parallel<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata) const -> void;
+template auto data::read_unpack_parallel<long long>(long long* data, long long undetect, long long nodata) const -> void;
+template auto data::read_unpack_parallel<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata) const -> void;
+template auto data::read_unpack_parallel<float>(float* data, float undetect, float nodata) const -> void;
+template auto data::read_unpack_parallel<double>(double* data, double undetect, double nodata) const -> void;
+template auto data::read_unpack_parallel<long double>(long double* data, long double undetect, long double nodata) const -> void;
+
+// number of elements unpacked by each job when a layer is unpacked asynchronously
+static constexpr size_t async_unpack_block = 65536;
+
+template <typename T>
+auto data::read_async(T* data) const -> std::future<void>
+{
+  async_group tasks;
+  auto ret = tasks.future();
+  try
+  {
+    const auto type = this->type();
+    auto layer = std::make_shared<raw_layer>();
+    if (   !raw_layer_open(hnd_, data_, type, *layer)
+        || !raw_layer_read_async<T>(hnd_, data_, layer, data, convert_kernel_for<T>(type), unpack_params<T>{}, tasks))
+      read(data);
+  }
+  catch (...)
+  {
+    tasks.fail(std::current_exception());
+  }
+  tasks.close();
+  return ret;
 }
 
-auto attribute_store::fix_attribute_parents(const attribute_store& old) -> void
+template <typename T>
+auto data::read_unpack_async(T* data, T undetect, T nodata) const -> std::future<void>
 {
-  // update the 'parent group' pointers for each attribute
-  for (auto& a : attrs_)
+  async_group tasks;
+  auto ret = tasks.future();
+  try
   {
-    if (a.parent_ == &old.what_)
-      a.parent_ = &what_;
-    else if (a.parent_ == &old.where_)
-      a.parent_ = &where_;
-    else
-      a.parent_ = &how_;
+    const auto type = this->type();
+    auto kernel = unpack_kernel_for<T>(type);
+    if (!kernel)
+      throw make_error(hnd_, "read dataset", "data", "unsupported storage type");
+
+    const unpack_params<T> params{gain(), offset(), this->nodata(), this->undetect(), nodata, undetect};
+    auto layer = std::make_shared<raw_layer>();
+    if (   !raw_layer_open(hnd_, data_, type, *layer)
+        || !raw_layer_read_async(hnd_, data_, layer, data, kernel, params, tasks))
+    {
+      // read the stored values now and unpack them on the pool
+      const auto size = this->size();
+      const auto tsize = storage_type_size(type);
+      std::shared_ptr<unsigned char> buf{new unsigned char[size * tsize], std::default_delete<unsigned char[]>()};
+      read_native(type, buf.get(), nullptr, nullptr, nullptr);
+      for (size_t i = 0; i < size; i += async_unpack_block)
+      {
+        auto count = std::min(async_unpack_block, size - i);
+        tasks.run([buf, tsize, data, i, count, kernel, params]
+        {
+          kernel(buf.get() + i * tsize, data + i, count, params);
+        });
+      }
+    }
+  }
+  catch (...)
+  {
+    tasks.fail(std::current_exception());
   }
+  tasks.close();
+  return ret;
 }
 
-auto attribute_store::find(const char* name) noexcept -> iterator
+template auto data::read_async<char>(char* data) const -> std::future<void>;
+template auto data::read_async<signed char>(signed char* data) const -> std::future<void>;
+template auto data::read_async<unsigned char>(unsigned char* data) const -> std::future<void>;
+template auto data::read_async<short>(short* data) const -> std::future<void>;
+template auto data::read_async<unsigned short>(unsigned short* data) const -> std::future<void>;
+template auto data::read_async<int>(int* data) const -> std::future<void>;
+template auto data::read_async<unsigned int>(unsigned int* data) const -> std::future<void>;
+template auto data::read_async<long>(long* data) const -> std::future<void>;
+template auto data::read_async<unsigned long>(unsigned long* data) const -> std::future<void>;
+template auto data::read_async<long long>(long long* data) const -> std::future<void>;
+template auto data::read_async<unsigned long long>(unsigned long long* data) const -> std::future<void>;
+template auto data::read_async<float>(float* data) const -> std::future<void>;
+template auto data::read_async<double>(double* data) const -> std::future<void>;
+template auto data::read_async<long double>(long double* data) const -> std::future<void>;
+
+template auto data::read_unpack_async<char>(char* data, char undetect, char nodata) const -> std::future<void>;
+template auto data::read_unpack_async<signed char>(signed char* data, signed char undetect, signed char nodata) const -> std::future<void>;
+template auto data::read_unpack_async<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata) const -> std::future<void>;
+template auto data::read_unpack_async<short>(short* data, short undetect, short nodata) const -> std::future<void>;
+template auto data::read_unpack_async<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata) const -> std::future<void>;
+template auto data::read_unpack_async<int>(int* data, int undetect, int nodata) const -> std::future<void>;
+template auto data::read_unpack_async<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata) const -> std::future<void>;
+template auto data::read_unpack_async<long>(long* data, long undetect, long nodata) const -> std::future<void>;
+template auto data::read_unpack_async<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata) const -> std::future<void>;
+template auto data::read_unpack_async<long long>(long long* data, long long undetect, long long nodata) const -> std::future<void>;
+template auto data::read_unpack_async<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata) const -> std::future<void>;
+template auto data::read_unpack_async<float>(float* data, float undetect, float nodata) const -> std::future<void>;
+template auto data::read_unpack_async<double>(double* data, double undetect, double nodata) const -> std::future<void>;
+template auto data::read_unpack_async<long double>(long double* data, long double undetect, long double nodata) const -> std::future<void>;
+
+/* Map a region of a file read only.  The mapping starts at the nearest boundary
+ * required by the system below offset, and its base and length are returned
+ * for unmapping.  Returns the address of offset within the mapping, or nullptr
+ * if the file could not be mapped. */
+static auto map_file_region(const std::string& path, uint64_t offset, size_t bytes, void*& base, size_t& length) -> const void*
+{
+#if defined(_WIN32)
+  // views must start on a multiple of the allocation granularity
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  const auto begin = offset - offset % info.dwAllocationGranularity;
+  length = static_cast<size_t>(offset - begin) + bytes;
+
+  auto file = CreateFileA(
+        path.c_str()
+      , GENERIC_READ
+      , FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE
+      , nullptr
+      , OPEN_EXISTING
+      , FILE_ATTRIBUTE_NORMAL
+      , nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return nullptr;
+  void* ptr = nullptr;
+  auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping)
+  {
+    ptr = MapViewOfFile(
+          mapping
+        , FILE_MAP_READ
+        , static_cast<DWORD>(begin >> 32)
+        , static_cast<DWORD>(begin)
+        , length);
+    CloseHandle(mapping);
+  }
+  CloseHandle(file);
+  if (!ptr)
+    return nullptr;
+#else
+  // mappings must start on a page boundary
+  const auto page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const auto begin = offset - offset % page;
+  length = static_cast<size_t>(offset - begin) + bytes;
+
+  auto fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  auto ptr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(begin));
+  close(fd);
+  if (ptr == MAP_FAILED)
+    return nullptr;
+#endif
+  base = ptr;
+  return static_cast<const unsigned char*>(ptr) + (offset - begin);
+}
+
+static auto unmap_file_region(void* base, size_t length) -> void
+{
+#if defined(_WIN32)
+  UnmapViewOfFile(base);
+#else
+  munmap(base, length);
+#endif
+}
+
+// determine whether a layer may be mapped directly, and if so its file path and offset
+static auto map_layer_locate(
+      const handle& hnd
+    , const handle& dset
+    , data::data_type type
+    , size_t size
+    , std::string& path
+    , haddr_t& offset
+    ) -> bool
+{
+  if (storage_type_size(type) == 0 || size == 0)
+    return false;
+
+  // the stored type must match our own exactly since the bytes are used as is
+  handle ftype{H5Dget_type(dset)};
+  if (!ftype)
+    throw make_error(hnd, "get dataset type", "data");
+  if (H5Tequal(ftype, hdf_memory_type(type)) <= 0)
+    return false;
+
+  handle plist{H5Dget_create_plist(dset)};
+  if (!plist)
+    throw make_error(hnd, "get dataset properties", "data");
+  if (H5Pget_layout(plist) != H5D_CONTIGUOUS || H5Pget_nfilters(plist) != 0)
+    return false;
+
+  // unallocated layers have no offset
+  offset = H5Dget_offset(dset);
+  if (offset == HADDR_UNDEF)
+    return false;
+
+  // the file must be backed by a plain file on disk
+  handle file{H5Iget_file_id(hnd)};
+  if (!file)
+    throw make_error(hnd, "get file", "data");
+  handle fapl{H5Fget_access_plist(file)};
+  if (!fapl)
+    throw make_error(hnd, "get file access properties", "data");
+  if (H5Pget_driver(fapl) != H5FD_SEC2)
+    return false;
+
+  auto len = H5Fget_name(file, nullptr, 0);
+  if (len <= 0)
+    return false;
+  path.resize(len + 1);
+  if (H5Fget_name(file, &path[0], path.size()) < 0)
+    throw make_error(hnd, "get file name", "data");
+  path.resize(len);
+
+  return true;
+}
+
+data::mapped_view::mapped_view() noexcept
+  : base_{nullptr}
+  , length_{0}
+  , data_{nullptr}
+  , type_{data_type::unknown}
+  , size_{0}
+  , params_{1.0, 0.0, 0.0, 0.0}
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
-    if (i->name() == name)
-      return i;
-  return attrs_.end();
+
 }
 
-auto attribute_store::find(const char* name) const noexcept -> const_iterator
+data::mapped_view::mapped_view(mapped_view&& rhs) noexcept
+  : base_{rhs.base_}
+  , length_{rhs.length_}
+  , data_{rhs.data_}
+  , type_{rhs.type_}
+  , size_{rhs.size_}
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
-    if (i->name() == name)
-      return i;
-  return attrs_.end();
+  std::copy(rhs.params_, rhs.params_ + 4, params_);
+  rhs.base_ = nullptr;
+  rhs.length_ = 0;
+  rhs.data_ = nullptr;
+  rhs.size_ = 0;
 }
 
-auto attribute_store::find(const std::string& name) noexcept -> iterator
+auto data::mapped_view::operator=(mapped_view&& rhs) noexcept -> mapped_view&
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
-    if (i->name() == name)
-      return i;
-  return attrs_.end();
+  std::swap(base_, rhs.base_);
+  std::swap(length_, rhs.length_);
+  std::swap(data_, rhs.data_);
+  std::swap(type_, rhs.type_);
+  std::swap(size_, rhs.size_);
+  std::swap(params_, rhs.params_);
+  return *this;
 }
 
-auto attribute_store::find(const std::string& name) const noexcept -> const_iterator
+data::mapped_view::~mapped_view()
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
-    if (i->name() == name)
-      return i;
-  return attrs_.end();
+  if (base_)
+    unmap_file_region(base_, length_);
 }
 
-auto attribute_store::operator[](const char* name) -> attribute&
+template <typename T>
+auto data::mapped_view::values() const -> const T*
 {
-  for (auto& a : attrs_)
-    if (a.name() == name)
-      return a;
+  if (H5Tequal(hdf_native_type<T>(), hdf_memory_type(type_)) <= 0)
+    throw make_error({}, "mapped view", "values", "type does not match storage type");
+  return static_cast<const T*>(data_);
+}
 
-  // okay, need to insert it
-  if (is_what_attribute(name))
+template <typename T>
+auto data::mapped_view::unpack(T* data, T undetect, T nodata, size_t offset, size_t count) const -> void
+{
+  auto kernel = unpack_kernel_for<T>(type_);
+  if (!kernel)
+    throw make_error({}, "mapped view", "unpack", "unsupported storage type");
+  if (offset > size_)
+    throw make_error({}, "mapped view", "unpack", "offset out of range");
+  count = std::min(count, size_ - offset);
+
+  const unpack_params<T> params{params_[0], params_[1], params_[2], params_[3], nodata, undetect};
+  kernel(static_cast<const unsigned char*>(data_) + offset * storage_type_size(type_), data, count, params);
+}
+
+template auto data::mapped_view::values<char>() const -> const char*;
+template auto data::mapped_view::values<signed char>() const -> const signed char*;
+template auto data::mapped_view::values<unsigned char>() const -> const unsigned char*;
+template auto data::mapped_view::values<short>() const -> const short*;
+template auto data::mapped_view::values<unsigned short>() const -> const unsigned short*;
+template auto data::mapped_view::values<int>() const -> const int*;
+template auto data::mapped_view::values<unsigned int>() const -> const unsigned int*;
+template auto data::mapped_view::values<long>() const -> const long*;
+template auto data::mapped_view::values<unsigned long>() const -> const unsigned long*;
+template auto data::mapped_view::values<long long>() const -> const long long*;
+template auto data::mapped_view::values<unsigned long long>() const -> const unsigned long long*;
+template auto data::mapped_view::values<float>() const -> const float*;
+template auto data::mapped_view::values<double>() const -> const double*;
+template auto data::mapped_view::values<long double>() const -> const long double*;
+
+template auto data::mapped_view::unpack<char>(char* data, char undetect, char nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<signed char>(signed char* data, signed char undetect, signed char nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<short>(short* data, short undetect, short nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<int>(int* data, int undetect, int nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<long>(long* data, long undetect, long nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<long long>(long long* data, long long undetect, long long nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<float>(float* data, float undetect, float nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<double>(double* data, double undetect, double nodata, size_t offset, size_t count) const -> void;
+template auto data::mapped_view::unpack<long double>(long double* data, long double undetect, long double nodata, size_t offset, size_t count) const -> void;
+
+auto data::mappable() const -> bool
+{
+  std::string path;
+  haddr_t offset;
+  return map_layer_locate(hnd_, data_, type(), size(), path, offset);
+}
+
+auto data::map_view() const -> mapped_view
+{
+  std::string path;
+  haddr_t offset;
+  if (!map_layer_locate(hnd_, data_, type(), size(), path, offset))
+    throw make_error(hnd_, "map dataset", "data", "layer is not stored contiguously without filters");
+
+  // ensure that any data written through the library has reached the file
   {
-    if (!what_)
-    {
-      what_ = handle{H5Gcreate(hnd_, "what", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!what_)
-        throw make_error(hnd_, "create group", "what");
-    }
-    attrs_.push_back({&what_, name, false});
+    handle file{H5Iget_file_id(hnd_)};
+    unsigned int intent;
+    if (!file || H5Fget_intent(file, &intent) < 0)
+      throw make_error(hnd_, "get file intent", "data");
+    if ((intent & H5F_ACC_RDWR) && H5Fflush(file, H5F_SCOPE_LOCAL) < 0)
+      throw make_error(hnd_, "flush");
   }
-  else if (is_where_attribute(name))
+
+  mapped_view ret;
+  auto ptr = map_file_region(path, offset, size() * storage_type_size(type()), ret.base_, ret.length_);
+  if (!ptr)
+    throw make_error(hnd_, "map dataset", path.c_str(), "failed to map file");
+
+  ret.data_ = ptr;
+  ret.type_ = type();
+  ret.size_ = size();
+  ret.params_[0] = gain();
+  ret.params_[1] = this->offset();
+  ret.params_[2] = nodata();
+  ret.params_[3] = undetect();
+  return ret;
+}
+
+auto data::storage_extents() const -> std::vector<extent>
+{
+  std::vector<extent> ret;
+  handle plist{H5Dget_create_plist(data_)};
+  if (!plist)
+    throw make_error(hnd_, "get dataset properties", "data");
+
+  auto layout = H5Pget_layout(plist);
+  if (layout == H5D_CONTIGUOUS)
   {
-    if (!where_)
-    {
-      where_ = handle{H5Gcreate(hnd_, "where", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!where_)
-        throw make_error(hnd_, "create group", "where");
-    }
-    attrs_.push_back({&where_, name, false});
+    // the offset reported for contiguous storage already includes any user block
+    auto addr = H5Dget_offset(data_);
+    if (addr != HADDR_UNDEF)
+      ret.push_back({addr, H5Dget_storage_size(data_)});
   }
-  else
+#if H5_VERSION_GE(1,10,5)
+  else if (layout == H5D_CHUNKED)
   {
-    if (!how_)
+    // chunk addresses are relative to the end of the user block
+    handle file{H5Iget_file_id(hnd_)};
+    handle fcpl{file ? H5Fget_create_plist(file) : -1};
+    hsize_t base;
+    if (!fcpl || H5Pget_userblock(fcpl, &base) < 0)
+      throw make_error(hnd_, "get file properties", "data");
+
+    handle space{H5Dget_space(data_)};
+    hsize_t count;
+    if (!space || H5Dget_num_chunks(data_, space, &count) < 0)
+      throw make_error(hnd_, "get chunk count", "data");
+    ret.reserve(count);
+    for (hsize_t i = 0; i < count; ++i)
     {
-      how_ = handle{H5Gcreate(hnd_, "how", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!how_)
-        throw make_error(hnd_, "create group", "how");
+      haddr_t addr;
+      hsize_t size;
+      if (H5Dget_chunk_info(data_, space, i, nullptr, nullptr, &addr, &size) < 0)
+        throw make_error(hnd_, "get chunk info", "data");
+      ret.push_back({base + addr, size});
     }
-    attrs_.push_back({&how_, name, false});
   }
-  return attrs_.back();
+#endif
+  return ret;
 }
 
-auto attribute_store::operator[](const char* name) const -> const attribute&
+template <typename T>
+auto data::write(const T* data) -> void
 {
-  for (auto& a : attrs_)
-    if (a.name() == name)
-      return a;
-  throw make_error(hnd_, "no such attribute", name);
+  auto err = H5Dwrite(data_, hdf_native_type<T>(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+  if (err < 0)
+    throw make_error(hnd_, "write dataset", "data", err);
 }
 
-auto attribute_store::erase(iterator i) -> void
+template auto data::write<char>(const char* data) -> void;
+template auto data::write<signed char>(const signed char* data) -> void;
+template auto data::write<unsigned char>(const unsigned char* data) -> void;
+template auto data::write<short>(const short* data) -> void;
+template auto data::write<unsigned short>(const unsigned short* data) -> void;
+template auto data::write<int>(const int* data) -> void;
+template auto data::write<unsigned int>(const unsigned int* data) -> void;
+template auto data::write<long>(const long* data) -> void;
+template auto data::write<unsigned long>(const unsigned long* data) -> void;
+template auto data::write<long long>(const long long* data) -> void;
+template auto data::write<unsigned long long>(const unsigned long long* data) -> void;
+template auto data::write<float>(const float* data) -> void;
+template auto data::write<double>(const double* data) -> void;
+template auto data::write<long double>(const long double* data) -> void;
+
+template <typename T>
+auto data::write(const T* data, const size_t* start, const size_t* count, const size_t* stride) -> void
 {
-  // remove the attribute from the file
-  if (i->type_ != attribute::data_type::uninitialized)
+  handle fspace, mspace;
+  select_hyperslab(hnd_, data_, start, count, stride, fspace, mspace);
+  auto err = H5Dwrite(data_, hdf_native_type<T>(), mspace, fspace, H5P_DEFAULT, data);
+  if (err < 0)
+    throw make_error(hnd_, "write dataset", "data", err);
+}
+
+template auto data::write<char>(const char* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<signed char>(const signed char* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<unsigned char>(const unsigned char* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<short>(const short* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<unsigned short>(const unsigned short* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<int>(const int* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<unsigned int>(const unsigned int* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<long>(const long* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<unsigned long>(const unsigned long* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<long long>(const long long* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<unsigned long long>(const unsigned long long* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<float>(const float* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<double>(const double* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+template auto data::write<long double>(const long double* data, const size_t* start, const size_t* count, const size_t* stride) -> void;
+
+auto data::write_streamed(data_type type, pack_block_fn pack, void* context) -> void
+{
+  const auto tsize = storage_type_size(type);
+  if (tsize == 0)
+    throw make_error(hnd_, "write dataset", "data", "unsupported storage type");
+
+  size_t dims[max_rank];
+  const auto rank = this->dims(dims);
+  if (rank == 0)
+    return;
+
+  // determine the number of elements in each ray (row)
+  size_t row = 1;
+  for (size_t i = 1; i < rank; ++i)
+    row *= dims[i];
+  if (row == 0 || dims[0] == 0)
+    return;
+
+  // write one chunk at a time where the layer is chunked and a chunk fits the stream buffer,
+  // otherwise blocks of whole rays limited by the buffer size (and the chunk height)
+  size_t block[max_rank];
+  std::copy(dims, dims + rank, block);
+  size_t rays = stream_block_size / (row * tsize);
+  bool by_chunk = false;
+  handle plist{H5Dget_create_plist(data_)};
+  if (!plist)
+    throw make_error(hnd_, "get dataset properties", "data");
+  if (H5Pget_layout(plist) == H5D_CHUNKED)
   {
-    if (H5Adelete(*i->parent_, i->name().c_str()) < 0)
-      throw make_error(hnd_, "attribute delete", i->name().c_str());
+    hsize_t chunk[H5S_MAX_RANK];
+    if (H5Pget_chunk(plist, H5S_MAX_RANK, chunk) < 0)
+      throw make_error(hnd_, "get dataset chunk", "data");
+    size_t bytes = tsize;
+    for (size_t i = 0; i < rank; ++i)
+      bytes *= chunk[i];
+    if (bytes <= stream_block_size)
+    {
+      for (size_t i = 0; i < rank; ++i)
+        block[i] = std::min<size_t>(chunk[i], dims[i]);
+      by_chunk = true;
+    }
+    else
+      rays = std::min<size_t>(rays, chunk[0]);
+  }
+  if (!by_chunk)
+    block[0] = std::max<size_t>(1, std::min(rays, dims[0]));
+
+  size_t block_size = tsize;
+  for (size_t i = 0; i < rank; ++i)
+    block_size *= block[i];
+  std::unique_ptr<unsigned char[]> buf{new unsigned char[block_size]};
+
+  // visit each block of the layer in row major order, clipping blocks at the edges
+  size_t start[max_rank], count[max_rank], pos[max_rank];
+  std::fill(start, start + rank, 0);
+  while (true)
+  {
+    for (size_t i = 0; i < rank; ++i)
+      count[i] = std::min(block[i], dims[i] - start[i]);
+
+    // pack the block as runs which are contiguous in the input, merging trailing dimensions spanned in full
+    size_t inner = rank - 1;
+    while (inner > 0 && count[inner] == dims[inner])
+      --inner;
+    size_t run = 1;
+    for (size_t i = inner; i < rank; ++i)
+      run *= count[i];
+    std::copy(start, start + rank, pos);
+    auto out = buf.get();
+    while (true)
+    {
+      size_t offset = 0;
+      for (size_t i = 0; i < rank; ++i)
+        offset = offset * dims[i] + pos[i];
+      pack(context, offset, run, out);
+      out += run * tsize;
+
+      size_t i = inner;
+      while (i > 0 && ++pos[i - 1] == start[i - 1] + count[i - 1])
+      {
+        pos[i - 1] = start[i - 1];
+        --i;
+      }
+      if (i == 0)
+        break;
+    }
+
+    handle fspace, mspace;
+    select_hyperslab(hnd_, data_, start, count, nullptr, fspace, mspace);
+    auto err = H5Dwrite(data_, hdf_memory_type(type), mspace, fspace, H5P_DEFAULT, buf.get());
+    if (err < 0)
+      throw make_error(hnd_, "write dataset", "data", err);
+
+    // advance to the next block
+    size_t i = rank;
+    while (i > 0 && (start[i - 1] += block[i - 1]) >= dims[i - 1])
+    {
+      start[i - 1] = 0;
+      --i;
+    }
+    if (i == 0)
+      break;
   }
-  
-  // now remove it from the store
-  attrs_.erase(i);
 }
 
-auto attribute_store::erase(const std::string& name) -> void
+// convert a packed range limit into type T without exceeding the limit
+template <typename T>
+static auto pack_limit(double val) -> T
+{
+  T ret = static_cast<T>(val);
+  if (std::abs(static_cast<double>(ret)) > std::abs(val))
+    ret = std::nextafter(ret, T(0));
+  return ret;
+}
+
+// determine the pack kernel parameters for a layer
+template <typename T>
+static auto pack_params_for(const data& layer, data::data_type type, data::pack_test is_undetect, data::pack_test is_nodata) -> pack_params<T>
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
+  const auto ud = layer.undetect();
+  const auto nd = layer.nodata();
+  const auto range = pack_range(type, ud, nd);
+  return
   {
-    if (i->name() == name)
-    {
-      erase(i);
-      break;
-    }
-  }
+      is_undetect.type()
+    , is_nodata.type()
+    , static_cast<T>(is_undetect.threshold())
+    , static_cast<T>(is_nodata.threshold())
+    , static_cast<T>(1.0 / layer.gain())
+    , static_cast<T>(layer.offset())
+    , pack_limit<T>(range.first)
+    , pack_limit<T>(range.second)
+    , static_cast<T>(ud)
+    , static_cast<T>(nd)
+  };
+}
+
+// convert the reduction accumulated while packing into a summary
+template <typename T>
+static auto pack_summary_from(const pack_reduction<T>& red) -> data::pack_summary
+{
+  if (red.valid == 0)
+    return {0, std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()};
+  return {red.valid, red.min, red.max};
 }
 
-group::group(handle::id_t hnd, bool existing)
-  : attribute_store{hnd, existing}
+template <typename T>
+auto data::write_pack(const T* data, pack_test is_undetect, pack_test is_nodata) -> pack_summary
 {
+  const auto type = this->type();
+  auto kernel = pack_kernel_for<T>(type);
+  if (!kernel)
+    throw make_error(hnd_, "write dataset", "data", "unsupported storage type");
 
-}
+  const auto params = pack_params_for<T>(*this, type, is_undetect, is_nodata);
 
-group::group(const handle& parent, const char* name, size_t index, bool existing)
-  : attribute_store{parent, name, index, existing}
-{
+  struct pack_context
+  {
+    const T*                data;
+    pack_fn<T>              kernel;
+    const pack_params<T>&   params;
+    pack_reduction<T>       red;
+  };
+  pack_context ctx{data, kernel, params, {0, std::numeric_limits<T>::infinity(), -std::numeric_limits<T>::infinity()}};
+
+  write_streamed(type, [](void* context, size_t offset, size_t count, void* out)
+  {
+    auto c = static_cast<pack_context*>(context);
+    c->kernel(c->data + offset, out, count, c->params, c->red);
+  }, &ctx);
 
+  return pack_summary_from(ctx.red);
 }
 
-group::~group()
+template auto data::write_pack<float>(const float* data, pack_test is_undetect, pack_test is_nodata) -> pack_summary;
+template auto data::write_pack<double>(const double* data, pack_test is_undetect, pack_test is_nodata) -> pack_summary;
+
+template <typename T>
+auto data::write_parallel(const T* data) -> void
 {
+  const auto type = this->type();
+  raw_layer layer;
+  if (!raw_layer_open(hnd_, data_, type, layer))
+  {
+    write(data);
+    return;
+  }
 
-}
+  auto kernel = store_kernel_for<T>(type);
+  raw_layer_write(hnd_, data_, layer, [data, kernel](size_t chunk, size_t index, size_t count, void* out)
+  {
+    kernel(data + index, out, count);
+  });
+}
+
+template auto data::write_parallel<char>(const char* data) -> void;
+template auto data::write_parallel<signed char>(const signed char* data) -> void;
+template auto data::write_parallel<unsigned char>(const unsigned char* data) -> void;
+template auto data::write_parallel<short>(const short* data) -> void;
+template auto data::write_parallel<unsigned short>(const unsigned short* data) -> void;
+template auto data::write_parallel<int>(const int* data) -> void;
+template auto data::write_parallel<unsigned int>(const unsigned int* data) -> void;
+template auto data::write_parallel<long>(const long* data) -> void;
+template auto data::write_parallel<unsigned long>(const unsigned long* data) -> void;
+template auto data::write_parallel<long long>(const long long* data) -> void;
+template auto data::write_parallel<unsigned long long>(const unsigned long long* data) -> void;
+template auto data::write_parallel<float>(const float* data) -> void;
+template auto data::write_parallel<double>(const double* data) -> void;
+template auto data::write_parallel<long double>(const long double* data) -> void;
 
-auto group::is_api_attribute(const std::string& name) const -> bool
+template <typename T>
+auto data::write_pack_parallel(const T* data, pack_test is_undetect, pack_test is_nodata) -> pack_summary
 {
-  return false;
+  const auto type = this->type();
+  raw_layer layer;
+  if (!raw_layer_open(hnd_, data_, type, layer))
+    return write_pack(data, is_undetect, is_nodata);
+
+  auto kernel = pack_kernel_for<T>(type);
+  if (!kernel)
+    throw make_error(hnd_, "write dataset", "data", "unsupported storage type");
+
+  const auto params = pack_params_for<T>(*this, type, is_undetect, is_nodata);
+
+  // each chunk accumulates its own reduction which are combined once all chunks are written
+  const pack_reduction<T> init{0, std::numeric_limits<T>::infinity(), -std::numeric_limits<T>::infinity()};
+  std::vector<pack_reduction<T>> reds(raw_layer_chunks(layer), init);
+  raw_layer_write(hnd_, data_, layer, [data, kernel, &params, &reds](size_t chunk, size_t index, size_t count, void* out)
+  {
+    kernel(data + index, out, count, params, reds[chunk]);
+  });
+
+  auto red = init;
+  for (auto& r : reds)
+  {
+    red.valid += r.valid;
+    red.min = std::min(red.min, r.min);
+    red.max = std::max(red.max, r.max);
+  }
+  return pack_summary_from(red);
 }
 
-data::data(const handle& parent, bool quality, size_t index)
-  : group{parent, quality ? "quality%zu" : "data%zu", index, true}
+template auto data::write_pack_parallel<float>(const float* data, pack_test is_undetect, pack_test is_nodata) -> pack_summary;
+template auto data::write_pack_parallel<double>(const double* data, pack_test is_undetect, pack_test is_nodata) -> pack_summary;
+
+dataset::dataset(const attribute_store& parent, size_t index, bool existing)
+  : group{parent, "dataset%zu", index, existing}
+  , size_data_{0}
   , size_quality_{0}
-  , data_{H5Dopen(hnd_, "data", H5P_DEFAULT)}
 {
-  if (!data_)
-    throw make_error(hnd_, "open dataset", "data");
-
-  // determine the number of dataX and qualityX layers
-  H5G_info_t info;
-  if (H5Gget_info(hnd_, &info) < 0)
-    throw make_error(hnd_, "get group info");
-  if (what_) --info.nlinks;
-  if (where_) --info.nlinks;
-  if (how_) --info.nlinks;
-  for (size_t i = info.nlinks; i > 0; --i)
-  {
-    char name[32];
-    sprintf_s(name, "quality%zu", i);
-    htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
-    if (ret < 0)
-      throw make_error(hnd_, "check group exists", name);
-    if (ret)
+  if (existing)
+  {
+    // determine the number of dataX and qualityX layers
+    if (node_)
     {
-      size_quality_ = i;
-      break;
+      size_data_ = node_->layers.size();
+      size_quality_ = node_->qualities.size();
+    }
+    else
+    {
+      auto links = index_links(hnd_);
+      size_data_ = links.data;
+      size_quality_ = links.quality;
     }
   }
 }
 
-data::data(
-      const handle& parent
-    , bool quality
-    , size_t index
-    , data_type type
-    , size_t rank
-    , const size_t* dims
-    , int compression)
-  : group{parent, quality ? "quality%zu" : "data%zu", index, false}
-  , size_quality_{0}
+auto dataset::data_find(const std::string& quantity) const -> size_t
 {
-  // convert dimension array to hdf size type
-  hsize_t hdims[max_rank];
-  for (size_t i = 0; i < rank; ++i)
-    hdims[i] = dims[i];
-
-  // create the dataset
-  handle space{H5Screate_simple(rank, hdims, hdims)};
-  if (!space)
-    throw make_error(hnd_, "create dataset");
-  handle plist{H5Pcreate(H5P_DATASET_CREATE)};
-  if (!plist)
-    throw make_error(hnd_, "create dataset");
-  if (   H5Pset_chunk(plist, rank, hdims) < 0
-      || (   compression > 0
-          && H5Pset_deflate(plist, compression) < 0))
-    throw make_error(hnd_, "create dataset");
-  data_ = H5Dcreate(hnd_, "data", hdf_storage_type(type), space, H5P_DEFAULT, plist, H5P_DEFAULT);
-  if (!data_)
-    throw make_error(hnd_, "create dataset");
-
-  // if 2d, add the image attributes (for sake of hdfview)
-  if (rank == 2)
+  if (node_)
   {
-    attribute{&data_, "CLASS", false}.set("IMAGE");
-    attribute{&data_, "IMAGE_VERSION", false}.set("1.2");
+    for (size_t i = 0; i < node_->layers.size(); ++i)
+      if (node_->layers[i] && node_->layers[i]->quantity == quantity)
+        return i;
+    return size_data_;
   }
-}
 
-auto data::quality_open(size_t i) const -> data
-{
-  return {hnd_, true, i};
+  for (size_t i = 0; i < size_data_; ++i)
+    if (data_open(i).quantity() == quantity)
+      return i;
+  return size_data_;
 }
 
-auto data::quality_append(data_type type, size_t rank, const size_t* dims, int compression) -> data
+auto dataset::data_open(size_t i) const -> data
 {
-  return {hnd_, true, size_quality_++, type, rank, dims, compression};
+  return {*this, false, i};
 }
 
-auto data::type() const -> data_type
+template <typename T>
+auto dataset::read_unpack_async(T* const* data, T undetect, T nodata) const -> std::vector<std::future<void>>
 {
-  handle id{H5Dget_type(data_)};
-  if (!id)
-    throw make_error(hnd_, "get dataset type");
-
-  auto type = H5Tget_class(id);
-  auto size = H5Tget_size(id);
-
-  if (type == H5T_INTEGER)
+  // errors opening a layer are reported through its future so that the others are not abandoned
+  std::vector<std::future<void>> ret(size_data_);
+  for (size_t i = 0; i < size_data_; ++i)
   {
-    auto sign = H5Tget_sign(id) == H5T_SGN_2;
-    switch (size)
+    if (!data[i])
+      continue;
+    try
     {
-    case 1:
-      return sign ? data_type::i8 : data_type::u8;
-    case 2:
-      return sign ? data_type::i16 : data_type::u16;
-    case 4:
-      return sign ? data_type::i32 : data_type::u32;
-    case 8:
-      return sign ? data_type::i64 : data_type::u64;
+      ret[i] = data_open(i).read_unpack_async(data[i], undetect, nodata);
     }
-  }
-  else if (type == H5T_FLOAT)
-  {
-    switch (size)
+    catch (...)
     {
-    case 4:
-      return data_type::f32;
-    case 8:
-      return data_type::f64;
+      std::promise<void> failed;
+      failed.set_exception(std::current_exception());
+      ret[i] = failed.get_future();
     }
   }
-
-  return data_type::unknown;
-}
-
-auto data::rank() const -> size_t
-{
-  handle space{H5Dget_space(data_)};
-  if (!space)
-    throw make_error(hnd_, "get dataset rank");
-  auto ret = H5Sget_simple_extent_ndims(space);
-  if (ret < 0)
-    throw make_error(hnd_, "get dataset rank");
   return ret;
 }
 
-auto data::dims(size_t* val) const -> size_t
+template auto dataset::read_unpack_async<char>(char* const* data, char undetect, char nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<signed char>(signed char* const* data, signed char undetect, signed char nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<unsigned char>(unsigned char* const* data, unsigned char undetect, unsigned char nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<short>(short* const* data, short undetect, short nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<unsigned short>(unsigned short* const* data, unsigned short undetect, unsigned short nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<int>(int* const* data, int undetect, int nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<unsigned int>(unsigned int* const* data, unsigned int undetect, unsigned int nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<long>(long* const* data, long undetect, long nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<unsigned long>(unsigned long* const* data, unsigned long undetect, unsigned long nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<long long>(long long* const* data, long long undetect, long long nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<unsigned long long>(unsigned long long* const* data, unsigned long long undetect, unsigned long long nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<float>(float* const* data, float undetect, float nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<double>(double* const* data, double undetect, double nodata) const -> std::vector<std::future<void>>;
+template auto dataset::read_unpack_async<long double>(long double* const* data, long double undetect, long double nodata) const -> std::vector<std::future<void>>;
+
+auto dataset::data_append(
+      data::data_type type
+    , size_t rank
+    , const size_t* dims
+    , const data::compression_options& compression
+    , const data::layout& storage
+    ) -> data
 {
-  handle space{H5Dget_space(data_)};
-  if (!space)
-    throw make_error(hnd_, "get dataset dims");
-  hsize_t dims[H5S_MAX_RANK];
-  auto rank = H5Sget_simple_extent_dims(space, dims, nullptr);
-  if (rank < 0)
-    throw make_error(hnd_, "get dataset dims");
-  for (decltype(rank) i = 0; i < rank; ++i)
-    val[i] = dims[i];
-  return rank;
+  return {*this, false, size_data_++, type, rank, dims, compression, storage};
 }
 
-auto data::size() const -> size_t
+auto dataset::quality_open(size_t i) const -> data
 {
-  handle space{H5Dget_space(data_)};
-  if (!space)
-    throw make_error(hnd_, "get dataset size");
-  auto ret = H5Sget_simple_extent_npoints(space);
-  if (ret < 0)
-    throw make_error(hnd_, "get dataset size");
-  return ret;
+  return {*this, true, i};
 }
 
-auto data::quantity() const -> std::string
+auto dataset::quality_append(
+      data::data_type type
+    , size_t rank
+    , const size_t* dims
+    , const data::compression_options& compression
+    , const data::layout& storage
+    ) -> data
 {
-  return attributes()["quantity"].get_string();
+  return {*this, true, size_quality_++, type, rank, dims, compression, storage};
 }
 
-auto data::set_quantity(const std::string& val) -> void
-{
-  attributes()["quantity"].set(val);
-}
+// size of each allocation made by the core driver when a file is built in memory
+constexpr size_t core_increment = 1024 * 1024;
 
-auto data::gain() const -> double
+static inline auto is_create(file::io_mode mode) -> bool
 {
-  return attributes()["gain"].get_real();
+  return mode == file::io_mode::create
+      || mode == file::io_mode::create_in_memory
+      || mode == file::io_mode::create_live;
 }
 
-auto data::set_gain(double val) -> void
+// build the file access property list for the tuning options
+static auto file_access_plist(const char* path, file::io_mode mode, const file::options& opts) -> handle
 {
-  attributes()["gain"].set(val);
-}
+  handle fapl{H5Pcreate(H5P_FILE_ACCESS)};
+  if (!fapl)
+    throw make_error({}, "file access properties", path);
 
-auto data::offset() const -> double
-{
-  return attributes()["offset"].get_real();
+  // core driver without a backing store, the path only names the file
+  if (   (mode == file::io_mode::create_in_memory || mode == file::io_mode::create_live)
+      && H5Pset_fapl_core(fapl, core_increment, false) < 0)
+    throw make_error({}, "file access properties", path, "failed to set core driver");
+
+  if (opts.chunk_cache_bytes > 0 || opts.chunk_cache_slots > 0 || opts.chunk_cache_preemption >= 0.0)
+  {
+    int mdc_nelmts;
+    size_t nslots, nbytes;
+    double w0;
+    if (H5Pget_cache(fapl, &mdc_nelmts, &nslots, &nbytes, &w0) < 0)
+      throw make_error({}, "file access properties", path, "failed to get chunk cache");
+    if (opts.chunk_cache_bytes > 0)
+      nbytes = opts.chunk_cache_bytes;
+    if (opts.chunk_cache_slots > 0)
+      nslots = opts.chunk_cache_slots;
+    if (opts.chunk_cache_preemption >= 0.0)
+      w0 = std::min(opts.chunk_cache_preemption, 1.0);
+    if (H5Pset_cache(fapl, mdc_nelmts, nslots, nbytes, w0) < 0)
+      throw make_error({}, "file access properties", path, "failed to set chunk cache");
+  }
+
+  if (opts.metadata_cache_size > 0)
+  {
+    H5AC_cache_config_t config;
+    config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+    if (H5Pget_mdc_config(fapl, &config) < 0)
+      throw make_error({}, "file access properties", path, "failed to get metadata cache");
+    config.set_initial_size = true;
+    config.initial_size = opts.metadata_cache_size;
+    config.min_size = std::min(config.min_size, config.initial_size);
+    config.max_size = std::max(config.max_size, config.initial_size);
+    if (H5Pset_mdc_config(fapl, &config) < 0)
+      throw make_error({}, "file access properties", path, "failed to set metadata cache");
+  }
+
+  if (opts.alignment > 0 && H5Pset_alignment(fapl, opts.alignment_threshold, opts.alignment) < 0)
+    throw make_error({}, "file access properties", path, "failed to set alignment");
+
+  if (opts.meta_block_size > 0 && H5Pset_meta_block_size(fapl, opts.meta_block_size) < 0)
+    throw make_error({}, "file access properties", path, "failed to set metadata block size");
+
+  if (opts.library_format != file::options::format::earliest)
+  {
+#if H5_VERSION_GE(1,10,2)
+    auto low = opts.library_format == file::options::format::v18 ? H5F_LIBVER_V18 : H5F_LIBVER_LATEST;
+#else
+    auto low = H5F_LIBVER_LATEST;
+#endif
+    if (H5Pset_libver_bounds(fapl, low, H5F_LIBVER_LATEST) < 0)
+      throw make_error({}, "file access properties", path, "failed to set library version bounds");
+  }
+
+  return fapl;
 }
 
-auto data::set_offset(double val) -> void
+// build the file creation property list for the creation options
+static auto file_create_plist(const char* path, const file::options& opts) -> handle
 {
-  attributes()["offset"].set(val);
+  handle fcpl{H5Pcreate(H5P_FILE_CREATE)};
+  if (!fcpl)
+    throw make_error({}, "file creation properties", path);
+
+#if H5_VERSION_GE(1,10,1)
+  // keep free space sections of any size across closing and reopening the file
+  if (opts.persist_free_space && H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_FSM_AGGR, 1, 1) < 0)
+    throw make_error({}, "file creation properties", path, "failed to set file space strategy");
+#else
+  (void) opts;
+#endif
+
+  return fcpl;
 }
 
-auto data::nodata() const -> double
+static inline auto file_checked_open_or_create(
+      const char* path
+    , file::io_mode mode
+    , const file::options& opts
+    ) -> handle::id_t
 {
-  return attributes()["nodata"].get_real();
+  auto fapl = file_access_plist(path, mode, opts);
+  handle::id_t ret;
+  if (is_create(mode))
+  {
+    auto fcpl = file_create_plist(path, opts);
+    ret = H5Fcreate(path, H5F_ACC_TRUNC, fcpl, fapl);
+  }
+  else
+    ret = H5Fopen(path, mode == file::io_mode::read_only ? H5F_ACC_RDONLY : H5F_ACC_RDWR, fapl);
+  if (ret < 0)
+    throw make_error({}, "file open", path);
+  return ret;
 }
 
-auto data::set_nodata(double val) -> void
+static inline auto file_checked_open_image(const void* image, size_t size) -> handle::id_t
 {
-  attributes()["nodata"].set(val);
+  // the image is neither copied nor released by hdf5, and is opened read only
+  auto ret = H5LTopen_file_image(
+        const_cast<void*>(image)
+      , size
+      , H5LT_FILE_IMAGE_DONT_COPY | H5LT_FILE_IMAGE_DONT_RELEASE);
+  if (ret < 0)
+    throw make_error({}, "file open", "image");
+  return ret;
 }
 
-auto data::undetect() const -> double
+// convert the what/object attribute value to an object type
+static auto parse_object_type(const std::string& str) -> file::object_type
 {
-  return attributes()["undetect"].get_real();
+  if (str == "PVOL")
+    return file::object_type::polar_volume;
+  else if (str == "CVOL")
+    return file::object_type::cartesian_volume;
+  else if (str == "SCAN")
+    return file::object_type::polar_scan;
+  else if (str == "RAY")
+    return file::object_type::polar_ray;
+  else if (str == "AZIM")
+    return file::object_type::azimuthal_object;
+  else if (str == "IMAGE")
+    return file::object_type::cartesian_image;
+  else if (str == "COMP")
+    return file::object_type::composite_image;
+  else if (str == "XSEC")
+    return file::object_type::vertical_cross_section;
+  else if (str == "VP")
+    return file::object_type::vertical_profile;
+  else if (str == "PIC")
+    return file::object_type::graphical_image;
+  return file::object_type::unknown;
 }
 
-auto data::set_undetect(double val) -> void
+file::file(const std::string& path, io_mode mode, const options& opts)
+  : file{file_checked_open_or_create(path.c_str(), mode, opts), mode, opts}
 {
-  attributes()["undetect"].set(val);
+  path_ = path;
 }
 
-auto data::is_api_attribute(const std::string& name) const -> bool
+file::file(const void* image, size_t size, const options& opts)
+  : file{file_checked_open_image(image, size), io_mode::read_only, opts}
 {
-  return 
-       name == "quantity"
-    || name == "gain"
-    || name == "offset"
-    || name == "nodata"
-    || name == "undetect"
-    || group::is_api_attribute(name);
+
 }
 
-template <typename T>
-auto data::read(T* data) const -> void
+file::file(handle::id_t hnd, io_mode mode, const options& opts)
+  : group{hnd, !is_create(mode), opts.attributes}
+  , mode_{mode}
+  , type_{object_type::unknown}
+  , size_{0}
+  , opts_{opts}
 {
-  auto err = H5Dread(data_, hdf_native_type<T>(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
-  if (err < 0)
-    throw make_error(hnd_, "read dataset", "data", err);
-}
+  if (!is_create(mode))
+  {
+    // determine the number of datasetX groups
+    if (opts.index_structure)
+    {
+      build_structure();
+      size_ = node_->datasets.size();
+    }
+    else
+      size_ = index_links(hnd_).datasets;
 
-template auto data::read<char>(char* data) const -> void;
-template auto data::read<signed char>(signed char* data) const -> void;
-template auto data::read<unsigned char>(unsigned char* data) const -> void;
-template auto data::read<short>(short* data) const -> void;
-template auto data::read<unsigned short>(unsigned short* data) const -> void;
-template auto data::read<int>(int* data) const -> void;
-template auto data::read<unsigned int>(unsigned int* data) const -> void;
-template auto data::read<long>(long* data) const -> void;
-template auto data::read<unsigned long>(unsigned long* data) const -> void;
-template auto data::read<long long>(long long* data) const -> void;
-template auto data::read<unsigned long long>(unsigned long long* data) const -> void;
-template auto data::read<float>(float* data) const -> void;
-template auto data::read<double>(double* data) const -> void;
-template auto data::read<long double>(long double* data) const -> void;
+    // determine the object type (read directly to avoid enumerating deferred attributes)
+    std::string str;
+    if (policy_ == load_policy::deferred)
+    {
+      handle what{H5Gopen(hnd_, "what", H5P_DEFAULT)};
+      if (!what)
+        throw make_error(hnd_, "group open", "what");
+      str = attribute{&what, "object", true}.get_string();
+    }
+    else
+      str = attributes()["object"].get_string();
+    type_ = parse_object_type(str);
+  }
+  else
+  {
+    // set the default conventions and version attributes
+    set_conventions(default_conventions);
+    set_version(default_version_major, default_version_minor);
+  }
+}
 
-template <typename T>
-auto data::write(const T* data) -> void
+// locate (creating if needed) the index node for a numbered child group
+static auto structure_insert(structure_node* node, const char* name, int depth) -> structure_node*
 {
-  auto err = H5Dwrite(data_, hdf_native_type<T>(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
-  if (err < 0)
-    throw make_error(hnd_, "write dataset", "data", err);
+  size_t i;
+  structure_node::children* list = nullptr;
+  if (depth == 0 && parse_link_index(name, "dataset", i))
+    list = &node->datasets;
+  else if (depth == 1 && parse_link_index(name, "data", i))
+    list = &node->layers;
+  else if (depth > 0 && depth < 3 && parse_link_index(name, "quality", i))
+    list = &node->qualities;
+  else
+    return nullptr;
+  if (i > node->links + max_link_index_gap)
+    return nullptr;
+  if (list->size() < i)
+    list->resize(i);
+  auto& child = (*list)[i - 1];
+  if (!child)
+    child.reset(new structure_node);
+  return child.get();
 }
 
-template auto data::write<char>(const char* data) -> void;
-template auto data::write<signed char>(const signed char* data) -> void;
-template auto data::write<unsigned char>(const unsigned char* data) -> void;
-template auto data::write<short>(const short* data) -> void;
-template auto data::write<unsigned short>(const unsigned short* data) -> void;
-template auto data::write<int>(const int* data) -> void;
-template auto data::write<unsigned int>(const unsigned int* data) -> void;
-template auto data::write<long>(const long* data) -> void;
-template auto data::write<unsigned long>(const unsigned long* data) -> void;
-template auto data::write<long long>(const long long* data) -> void;
-template auto data::write<unsigned long long>(const unsigned long long* data) -> void;
-template auto data::write<float>(const float* data) -> void;
-template auto data::write<double>(const double* data) -> void;
-template auto data::write<long double>(const long double* data) -> void;
-
-dataset::dataset(const handle& parent, size_t index, bool existing)
-  : group{parent, "dataset%zu", index, existing}
-  , size_data_{0}
-  , size_quality_{0}
+// visit every object in the file once and build the structure index
+auto file::build_structure() -> void
 {
-  if (existing)
+  struct visit_data
   {
-    // determine the number of dataX and qualityX layers
-    H5G_info_t info;
-    if (H5Gget_info(hnd_, &info) < 0)
-      throw make_error(hnd_, "get group info");
-    if (what_) --info.nlinks;
-    if (where_) --info.nlinks;
-    if (how_) --info.nlinks;
-    for (size_t i = info.nlinks; i > 0; --i)
+    structure_node*                                     root;
+    std::vector<std::pair<structure_node*, std::string>> whats;
+  };
+  auto root = std::make_shared<structure_node>();
+  H5G_info_t ginfo;
+  if (H5Gget_info(hnd_, &ginfo) < 0)
+    throw make_error(hnd_, "get group info");
+  root->links = ginfo.nlinks;
+  visit_data vd{root.get(), {}};
+
+  auto op = [](hid_t obj, const char* name, const object_info* info, void* op_data) -> herr_t
+  {
+    auto vd = static_cast<visit_data*>(op_data);
+
+    // walk the path to the node of the parent group
+    std::string path{name};
+    structure_node* node = vd->root;
+    int depth = 0;
+    size_t pos = 0, next;
+    while ((next = path.find('/', pos)) != std::string::npos)
     {
-      char name[32];
-      sprintf_s(name, "data%zu", i);
-      htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
-      if (ret < 0)
-        throw make_error(hnd_, "check group exists", name);
-      if (ret)
-      {
-        size_data_ = i;
-        break;
-      }
+      node = structure_insert(node, path.substr(pos, next - pos).c_str(), depth++);
+      if (!node)
+        return 0;
+      pos = next + 1;
     }
-    info.nlinks -= size_data_;
-    for (size_t i = info.nlinks; i > 0; --i)
+    auto leaf = path.substr(pos);
+
+#if H5_VERSION_GE(1,12,0)
+    auto& token = info->token;
+#else
+    auto& token = info->addr;
+#endif
+    if (info->type == H5O_TYPE_GROUP)
     {
-      char name[32];
-      sprintf_s(name, "quality%zu", i);
-      htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
-      if (ret < 0)
-        throw make_error(hnd_, "check group exists", name);
-      if (ret)
+      if (auto child = structure_insert(node, leaf.c_str(), depth))
       {
-        size_quality_ = i;
-        break;
+        // groups are visited before their members, so the link count is known before they are inserted
+        H5G_info_t ginfo;
+        if (H5Gget_info_by_name(obj, name, &ginfo, H5P_DEFAULT) < 0)
+          return -1;
+        child->has_group = true;
+        child->group = token;
+        child->links = ginfo.nlinks;
       }
+      else if (depth > 1 && leaf == "what")
+        vd->whats.emplace_back(node, path);
+    }
+    else if (info->type == H5O_TYPE_DATASET && depth > 1 && leaf == "data")
+    {
+      node->has_layer = true;
+      node->layer = token;
     }
+    return 0;
+  };
+#if H5_VERSION_GE(1,12,0)
+  if (H5Ovisit3(hnd_, H5_INDEX_NAME, H5_ITER_NATIVE, op, &vd, H5O_INFO_BASIC) < 0)
+#else
+  if (H5Ovisit2(hnd_, H5_INDEX_NAME, H5_ITER_NATIVE, op, &vd, H5O_INFO_BASIC) < 0)
+#endif
+    throw make_error(hnd_, "visit objects");
+
+  // determine the quantity of each layer
+  for (auto& w : vd.whats)
+  {
+    handle what{H5Gopen(hnd_, w.second.c_str(), H5P_DEFAULT)};
+    if (!what)
+      throw make_error(hnd_, "group open", w.second.c_str());
+    if (H5Aexists(what, "quantity") > 0)
+      w.first->quantity = attribute{&what, "quantity", true}.get_string();
   }
-}
 
-auto dataset::data_open(size_t i) const -> data
-{
-  return {hnd_, false, i};
-}
+  // determine the storage type and shape of each layer
+  std::function<void(structure_node&)> shape = [&](structure_node& node)
+  {
+    if (node.has_layer)
+    {
+      handle dset{object_open(hnd_, node.layer)};
+      if (!dset)
+        throw make_error(hnd_, "open dataset", "data");
+      node.type = dataset_storage_type(hnd_, dset);
+      handle space{H5Dget_space(dset)};
+      hsize_t dims[H5S_MAX_RANK];
+      auto rank = space ? H5Sget_simple_extent_dims(space, dims, nullptr) : -1;
+      if (rank < 0)
+        throw make_error(hnd_, "get dataset dims");
+      node.dims.assign(dims, dims + rank);
+    }
+    for (auto list : { &node.datasets, &node.layers, &node.qualities })
+      for (auto& child : *list)
+        if (child)
+          shape(*child);
+  };
+  shape(*root);
 
-auto dataset::data_append(data::data_type type, size_t rank, const size_t* dims, int compression) -> data
-{
-  return {hnd_, false, size_data_++, type, rank, dims, compression};
+  structure_ = std::move(root);
+  node_ = structure_.get();
 }
 
-auto dataset::quality_open(size_t i) const -> data
+auto file::flush() -> void
 {
-  return {hnd_, true, i};
+  if (H5Fflush(hnd_, H5F_SCOPE_LOCAL) < 0) 
+    throw make_error(hnd_, "flush");
 }
 
-auto dataset::quality_append(data::data_type type, size_t rank, const size_t* dims, int compression) -> data
-{
-  return {hnd_, true, size_quality_++, type, rank, dims, compression};
+/* Write a sequence of buffers to a uniquely named temporary file alongside
+ * path, sync it and then rename it over path so that readers see either the
+ * old or new file in full.  Returns the path which could not be written, or an
+ * empty string. */
+static auto replace_file(const std::string& path, std::initializer_list<std::pair<const void*, size_t>> parts) -> std::string
+{
+  // create the temporary file in the destination directory so the rename stays on one volume
+#if defined(_WIN32)
+  auto sep = path.find_last_of("/\\");
+  auto dir = sep == std::string::npos ? std::string(".") : path.substr(0, sep + 1);
+  char name[MAX_PATH];
+  if (GetTempFileNameA(dir.c_str(), "odm", 0, name) == 0)
+    return dir;
+  std::string tmp = name;
+  auto fp = fopen(tmp.c_str(), "wb");
+  if (!fp)
+  {
+    remove(tmp.c_str());
+    return tmp;
+  }
+#else
+  auto tmp = path + ".XXXXXX";
+  auto fd = mkstemp(&tmp[0]);
+  if (fd < 0)
+    return tmp;
+
+  // mkstemp creates the file private to the user, so give it the mode of the file it replaces
+  struct stat st;
+  mode_t mode;
+  if (stat(path.c_str(), &st) == 0)
+    mode = st.st_mode & 07777;
+  else
+  {
+    auto mask = umask(0);
+    umask(mask);
+    mode = 0666 & ~mask;
+  }
+  auto fp = fchmod(fd, mode) == 0 ? fdopen(fd, "wb") : nullptr;
+  if (!fp)
+  {
+    close(fd);
+    remove(tmp.c_str());
+    return tmp;
+  }
+#endif
+  auto ok = true;
+  for (auto& part : parts)
+    ok = ok && fwrite(part.first, 1, part.second, fp) == part.second;
+  ok = ok && fflush(fp) == 0;
+#if defined(_WIN32)
+  ok = ok && _commit(_fileno(fp)) == 0;
+#else
+  ok = ok && fsync(fileno(fp)) == 0;
+#endif
+  ok = fclose(fp) == 0 && ok;
+  if (!ok)
+  {
+    remove(tmp.c_str());
+    return tmp;
+  }
+
+  // rename over any existing destination
+#if defined(_WIN32)
+  ok = MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  ok = rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+  if (!ok)
+  {
+    remove(tmp.c_str());
+    return path;
+  }
+  return {};
 }
 
-static inline auto file_checked_open_or_create(
-      const char* path
-    , file::io_mode mode
-    ) -> handle::id_t
+auto file::image() const -> std::vector<char>
 {
-  auto ret = mode == file::io_mode::create
-   ? H5Fcreate(path, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT)
-   : H5Fopen(path, mode == file::io_mode::read_only ? H5F_ACC_RDONLY : H5F_ACC_RDWR, H5P_DEFAULT);
-  if (ret < 0)
-    throw make_error({}, "file open", path);
+  // flush so that the image includes all cached metadata, then size and copy it
+  if (H5Fflush(hnd_, H5F_SCOPE_LOCAL) < 0)
+    throw make_error(hnd_, "flush");
+  auto size = H5Fget_file_image(hnd_, nullptr, 0);
+  if (size < 0)
+    throw make_error(hnd_, "get file image");
+  std::vector<char> ret(size);
+  if (H5Fget_file_image(hnd_, ret.data(), ret.size()) < 0)
+    throw make_error(hnd_, "get file image");
   return ret;
 }
 
-file::file(const std::string& path, io_mode mode)
-  : group{file_checked_open_or_create(path.c_str(), mode), mode != io_mode::create}
-  , mode_{mode}
-  , type_{object_type::unknown}
-  , size_{0}
+auto file::commit(const std::string& path) const -> void
 {
-  if (mode != io_mode::create)
-  {
-    // determine the number of datasetX groups
-    H5G_info_t info;
-    if (H5Gget_info(hnd_, &info) < 0)
-      throw make_error(hnd_, "get group info");
-    if (what_) --info.nlinks;
-    if (where_) --info.nlinks;
-    if (how_) --info.nlinks;
-    for (size_t i = info.nlinks; i > 0; --i)
-    {
-      char name[32];
-      sprintf_s(name, "dataset%zu", i);
-      htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
-      if (ret < 0)
-        throw make_error(hnd_, "check group exists", name);
-      if (ret)
-      {
-        size_ = i;
-        break;
-      }
-    }
+  auto buf = image();
+  auto failed = replace_file(path, {{buf.data(), buf.size()}});
+  if (!failed.empty())
+    throw make_error(hnd_, "file commit", failed.c_str());
+}
 
-    // determine the object type
-    auto str = attributes()["object"].get_string();
-    if (str == "PVOL")
-      type_ = object_type::polar_volume;
-    else if (str == "CVOL")
-      type_ = object_type::cartesian_volume;
-    else if (str == "SCAN")
-      type_ = object_type::polar_scan;
-    else if (str == "RAY")
-      type_ = object_type::polar_ray;
-    else if (str == "AZIM")
-      type_ = object_type::azimuthal_object;
-    else if (str == "IMAGE")
-      type_ = object_type::cartesian_image;
-    else if (str == "COMP")
-      type_ = object_type::composite_image;
-    else if (str == "XSEC")
-      type_ = object_type::vertical_cross_section;
-    else if (str == "VP")
-      type_ = object_type::vertical_profile;
-    else if (str == "PIC")
-      type_ = object_type::graphical_image;
-  }
-  else
-  {
-    // set the default conventions and version attributes
-    set_conventions(default_conventions);
-    set_version(default_version_major, default_version_minor);
-  }
+auto file::publish() const -> void
+{
+  if (mode_ != io_mode::create_live)
+    throw make_error(hnd_, "file publish", path_.c_str(), "file was not created using io_mode::create_live");
+  commit(path_);
 }
 
-auto file::flush() -> void
+auto file::refresh() -> void
 {
-  if (H5Fflush(hnd_, H5F_SCOPE_LOCAL) < 0) 
-    throw make_error(hnd_, "flush");
+  if (is_create(mode_) || path_.empty())
+    throw make_error(hnd_, "file refresh", path_.c_str(), "file was not opened by path for reading");
+
+  // open the current file at our path, then take its place
+  file latest{path_, mode_, opts_};
+  if (latest.type_ != type_)
+    throw make_error(latest.hnd_, "unexpected object type", path_.c_str());
+  *this = std::move(latest);
 }
 
 template <class T>
 auto file::dset_open_as(size_t i) const -> T
 {
-  return {hnd_, i, true};
+  return {*this, i, true};
 }
 
 template auto file::dset_open_as<dataset>(size_t i) const -> dataset;
@@ -1271,9 +4558,10 @@ template auto file::dset_open_as<profile>(size_t i) const -> profile;
 template <class T>
 auto file::dset_make_as() -> T
 {
-  return {hnd_, size_++, false};
+  return {*this, size_++, false};
 }
 
+template auto file::dset_make_as<dataset>() -> dataset;
 template auto file::dset_make_as<scan>() -> scan;
 template auto file::dset_make_as<profile>() -> profile;
 
@@ -1558,19 +4846,26 @@ auto scan::is_api_attribute(const std::string& name) const -> bool
     || dataset::is_api_attribute(name);
 }
 
-polar_volume::polar_volume(const std::string& path, io_mode mode)
-  : file{path, mode}
+polar_volume::polar_volume(const std::string& path, io_mode mode, const options& opts)
+  : file{path, mode, opts}
 {
-  if (mode_ == io_mode::create)
+  if (is_create(mode_))
     set_object(object_type::polar_volume);
   else if (type_ != object_type::polar_volume)
     throw make_error(hnd_, "unexpected object type", "polar_volume");
 }
 
+polar_volume::polar_volume(const void* image, size_t size, const options& opts)
+  : file{image, size, opts}
+{
+  if (type_ != object_type::polar_volume)
+    throw make_error(hnd_, "unexpected object type", "polar_volume");
+}
+
 polar_volume::polar_volume(file f)
   : file{std::move(f)}
 {
-  if (mode_ == io_mode::create)
+  if (is_create(mode_))
     set_object(object_type::polar_volume);
   else if (type_ != object_type::polar_volume)
     throw make_error(hnd_, "unexpected object type", "polar_volume");
@@ -1615,19 +4910,26 @@ auto polar_volume::is_api_attribute(const std::string& name) const -> bool
     || file::is_api_attribute(name);
 }
 
-vertical_profile::vertical_profile(const std::string& path, io_mode mode)
-  : file{path, mode}
+vertical_profile::vertical_profile(const std::string& path, io_mode mode, const options& opts)
+  : file{path, mode, opts}
 {
-  if (mode_ == io_mode::create)
+  if (is_create(mode_))
     set_object(object_type::vertical_profile);
   else if (type_ != object_type::vertical_profile)
     throw make_error(hnd_, "unexpected object type", "vertical_profile");
 }
 
+vertical_profile::vertical_profile(const void* image, size_t size, const options& opts)
+  : file{image, size, opts}
+{
+  if (type_ != object_type::vertical_profile)
+    throw make_error(hnd_, "unexpected object type", "vertical_profile");
+}
+
 vertical_profile::vertical_profile(file f)
   : file{std::move(f)}
 {
-  if (mode_ == io_mode::create)
+  if (is_create(mode_))
     set_object(object_type::vertical_profile);
   else if (type_ != object_type::vertical_profile)
     throw make_error(hnd_, "unexpected object type", "vertical_profile");
@@ -1792,3 +5094,829 @@ auto profile::is_api_attribute(const std::string& name) const -> bool
     || dataset::is_api_attribute(name);
 }
 
+// open an attribute by path, returning an invalid handle if it does not exist
+static auto summary_attribute(const handle& file, const char* group, const char* name) -> handle
+{
+  handle ret;
+  H5E_BEGIN_TRY
+  {
+    ret = handle{H5Aopen_by_name(file, group, name, H5P_DEFAULT, H5P_DEFAULT)};
+  }
+  H5E_END_TRY;
+  return ret;
+}
+
+// read a fixed or variable length string attribute by path
+static auto summary_string(const handle& file, const char* group, const char* name, std::string& out) -> void
+{
+  auto attr = summary_attribute(file, group, name);
+  if (!attr)
+    return;
+  handle type{H5Aget_type(attr)};
+  if (!type || H5Tget_class(type) != H5T_STRING)
+    return;
+  if (H5Tis_variable_str(type) > 0)
+  {
+    handle mem{H5Tcopy(H5T_C_S1)};
+    char* str = nullptr;
+    if (!mem || H5Tset_size(mem, H5T_VARIABLE) < 0 || H5Aread(attr, mem, &str) < 0)
+      throw make_error(attr, "attribute read", name, "string");
+    if (str)
+    {
+      out = str;
+      H5free_memory(str);
+    }
+  }
+  else
+  {
+    auto size = H5Tget_size(type);
+    std::unique_ptr<char[]> buf{new char[size + 1]};
+    if (H5Aread(attr, type, buf.get()) < 0)
+      throw make_error(attr, "attribute read", name, "string");
+    buf[size] = '\0';
+    out = buf.get();
+  }
+}
+
+// read a scalar real attribute by path
+static auto summary_real(const handle& file, const char* group, const char* name, double& out) -> void
+{
+  auto attr = summary_attribute(file, group, name);
+  if (attr && H5Aread(attr, H5T_NATIVE_DOUBLE, &out) < 0)
+    throw make_error(attr, "attribute read", name, "real");
+}
+
+auto odim_h5::read_summary(const std::string& path) -> file_summary
+{
+  handle file{H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT)};
+  if (!file)
+    throw make_error({}, "file open", path.c_str());
+
+  file_summary ret;
+  std::string object;
+  summary_string(file, "what", "object", object);
+  ret.object = parse_object_type(object);
+  summary_string(file, "what", "date", ret.date);
+  summary_string(file, "what", "time", ret.time);
+  summary_string(file, "what", "source", ret.source);
+
+  ret.datasets.resize(index_links(file).datasets);
+  char name[64];
+  for (size_t i = 0; i < ret.datasets.size(); ++i)
+  {
+    auto& dset = ret.datasets[i];
+    dset.elangle = std::numeric_limits<double>::quiet_NaN();
+    snprintf(name, sizeof(name), "dataset%zu/where", i + 1);
+    summary_real(file, name, "elangle", dset.elangle);
+    snprintf(name, sizeof(name), "dataset%zu/what", i + 1);
+    summary_string(file, name, "startdate", dset.start_date);
+    summary_string(file, name, "starttime", dset.start_time);
+  }
+  return ret;
+}
+
+/* Catalogue file layout.  A header is followed by the file, sweep, layer,
+ * dimension and chunk tables and finally a block of nul terminated strings.
+ * Every record is a multiple of 8 bytes so that each table is naturally
+ * aligned within the mapping.  Records refer to each other and to strings by
+ * index and offset respectively. */
+static constexpr char     catalogue_magic[8] = {'O', 'D', 'I', 'M', 'C', 'A', 'T', '\0'};
+static constexpr uint32_t catalogue_version = 2;
+static constexpr uint32_t catalogue_byte_order = 0x01020304;
+
+struct catalogue_header
+{
+  char      magic[8];
+  uint32_t  version;
+  uint32_t  byte_order;
+  uint64_t  files;
+  uint64_t  sweeps;
+  uint64_t  layers;
+  uint64_t  dims;
+  uint64_t  chunks;
+  uint64_t  strings;    // bytes
+};
+
+struct catalogue_file
+{
+  uint64_t  path;       // string offset
+  uint64_t  source;     // string offset
+  uint64_t  size;       // file size in bytes
+  int64_t   mtime;      // file modification time (nanoseconds on POSIX, FILETIME on Windows)
+  int64_t   time;       // nominal product time
+  uint64_t  first_sweep;
+  uint32_t  sweeps;
+  uint32_t  object;
+};
+
+struct catalogue_sweep
+{
+  uint64_t  file;
+  double    elangle;
+  int64_t   start;
+  uint64_t  first_layer;
+  uint32_t  index;
+  uint32_t  layers;
+};
+
+struct catalogue_layer
+{
+  uint64_t  sweep;
+  uint64_t  quantity;   // string offset
+  uint64_t  first_dim;
+  uint64_t  first_chunk;
+  uint64_t  chunks;
+  uint32_t  index;
+  uint16_t  type;
+  uint16_t  rank;
+};
+
+static_assert(sizeof(catalogue_header) == 64, "unexpected catalogue header size");
+static_assert(sizeof(catalogue_file) == 56, "unexpected catalogue file record size");
+static_assert(sizeof(catalogue_sweep) == 40, "unexpected catalogue sweep record size");
+static_assert(sizeof(catalogue_layer) == 48, "unexpected catalogue layer record size");
+static_assert(sizeof(catalogue::chunk) == 16, "unexpected catalogue chunk record size");
+
+// pointers to the tables of a mapped catalogue
+struct catalogue_tables
+{
+  const catalogue_header*   header;
+  const catalogue_file*     files;
+  const catalogue_sweep*    sweeps;
+  const catalogue_layer*    layers;
+  const uint64_t*           dims;
+  const catalogue::chunk*   chunks;
+  const char*               strings;
+};
+
+// locate the tables of a catalogue, returning false if it is truncated or invalid
+static auto catalogue_locate(const void* base, size_t length, catalogue_tables& out) -> bool
+{
+  if (length < sizeof(catalogue_header))
+    return false;
+  auto hdr = static_cast<const catalogue_header*>(base);
+  if (   memcmp(hdr->magic, catalogue_magic, sizeof(catalogue_magic)) != 0
+      || hdr->version != catalogue_version
+      || hdr->byte_order != catalogue_byte_order)
+    return false;
+
+  auto at = static_cast<const char*>(base) + sizeof(catalogue_header);
+  auto end = static_cast<const char*>(base) + length;
+  auto take = [&](uint64_t count, size_t size) -> const char*
+  {
+    auto ret = at;
+    if (!at || count > static_cast<uint64_t>(end - at) / size)
+      return at = nullptr;
+    at += count * size;
+    return ret;
+  };
+  out.header = hdr;
+  out.files = reinterpret_cast<const catalogue_file*>(take(hdr->files, sizeof(catalogue_file)));
+  out.sweeps = reinterpret_cast<const catalogue_sweep*>(take(hdr->sweeps, sizeof(catalogue_sweep)));
+  out.layers = reinterpret_cast<const catalogue_layer*>(take(hdr->layers, sizeof(catalogue_layer)));
+  out.dims = reinterpret_cast<const uint64_t*>(take(hdr->dims, sizeof(uint64_t)));
+  out.chunks = reinterpret_cast<const catalogue::chunk*>(take(hdr->chunks, sizeof(catalogue::chunk)));
+  out.strings = take(hdr->strings, 1);
+  return at && (hdr->strings == 0 || out.strings[hdr->strings - 1] == '\0');
+}
+
+/* Check that every record refers only to strings and records within the
+ * catalogue.  This is done once when the catalogue is opened so that lookups
+ * may follow the references without checking them. */
+static auto catalogue_validate(const catalogue_tables& t) -> bool
+{
+  auto hdr = t.header;
+  auto within = [](uint64_t first, uint64_t count, uint64_t total)
+  {
+    return count <= total && first <= total - count;
+  };
+  for (uint64_t i = 0; i < hdr->files; ++i)
+  {
+    auto& f = t.files[i];
+    if (   f.path >= hdr->strings
+        || f.source >= hdr->strings
+        || !within(f.first_sweep, f.sweeps, hdr->sweeps))
+      return false;
+  }
+  for (uint64_t i = 0; i < hdr->sweeps; ++i)
+  {
+    auto& s = t.sweeps[i];
+    if (   s.file >= hdr->files
+        || !within(s.first_layer, s.layers, hdr->layers))
+      return false;
+  }
+  for (uint64_t i = 0; i < hdr->layers; ++i)
+  {
+    auto& l = t.layers[i];
+    if (   l.sweep >= hdr->sweeps
+        || l.quantity >= hdr->strings
+        || !within(l.first_dim, l.rank, hdr->dims)
+        || !within(l.first_chunk, l.chunks, hdr->chunks))
+      return false;
+  }
+  return true;
+}
+
+// catalogue tables being built in memory
+struct catalogue_builder
+{
+  std::vector<catalogue_file>   files;
+  std::vector<catalogue_sweep>  sweeps;
+  std::vector<catalogue_layer>  layers;
+  std::vector<uint64_t>         dims;
+  std::vector<catalogue::chunk> chunks;
+  std::string                   strings;
+
+  auto add_string(const char* str) -> uint64_t
+  {
+    auto ret = strings.size();
+    strings.append(str);
+    strings.push_back('\0');
+    return ret;
+  }
+
+  // sizes of each table, used to discard a partially added file
+  struct mark
+  {
+    size_t files, sweeps, layers, dims, chunks, strings;
+  };
+
+  auto position() const -> mark
+  {
+    return {files.size(), sweeps.size(), layers.size(), dims.size(), chunks.size(), strings.size()};
+  }
+
+  auto rewind(const mark& m) -> void
+  {
+    files.resize(m.files);
+    sweeps.resize(m.sweeps);
+    layers.resize(m.layers);
+    dims.resize(m.dims);
+    chunks.resize(m.chunks);
+    strings.resize(m.strings);
+  }
+};
+
+// file found while walking a directory tree
+struct catalogue_entry
+{
+  std::string path;
+  uint64_t    size;
+  int64_t     mtime;
+};
+
+static auto catalogue_candidate(const std::string& name) -> bool
+{
+  auto dot = name.rfind('.');
+  if (dot == std::string::npos)
+    return false;
+  auto ext = name.substr(dot + 1);
+  for (auto& c : ext)
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  return ext == "h5" || ext == "hdf5" || ext == "hdf";
+}
+
+// recursively collect candidate files below a directory
+static auto catalogue_walk(const std::string& dir, std::vector<catalogue_entry>& out) -> void
+{
+#if defined(_WIN32)
+  WIN32_FIND_DATAA info;
+  auto find = FindFirstFileA((dir + "\\*").c_str(), &info);
+  if (find == INVALID_HANDLE_VALUE)
+    return;
+  do
+  {
+    std::string name{info.cFileName};
+    if (name == "." || name == ".." || (info.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+      continue;
+    auto path = dir + "/" + name;
+    if (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      catalogue_walk(path, out);
+    else if (catalogue_candidate(name))
+    {
+      auto size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+      auto mtime = (static_cast<int64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+      out.push_back({std::move(path), size, mtime});
+    }
+  } while (FindNextFileA(find, &info));
+  FindClose(find);
+#else
+  auto d = opendir(dir.c_str());
+  if (!d)
+    return;
+  while (auto ent = readdir(d))
+  {
+    std::string name{ent->d_name};
+    if (name == "." || name == "..")
+      continue;
+    auto path = dir + "/" + name;
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode))
+      catalogue_walk(path, out);
+    else if (S_ISREG(st.st_mode) && catalogue_candidate(name))
+    {
+      // use the full timestamp resolution so that rewrites within the same second are detected
+#if defined(__APPLE__)
+      auto& ts = st.st_mtimespec;
+#else
+      auto& ts = st.st_mtim;
+#endif
+      auto mtime = static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+      out.push_back({std::move(path), static_cast<uint64_t>(st.st_size), mtime});
+    }
+  }
+  closedir(d);
+#endif
+}
+
+// suppress automatic printing of the HDF5 error stack while scanning files which may be invalid
+class hdf_error_silencer
+{
+public:
+  hdf_error_silencer()
+  {
+    H5Eget_auto2(H5E_DEFAULT, &func_, &data_);
+    H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+  }
+
+  hdf_error_silencer(const hdf_error_silencer&) = delete;
+  auto operator=(const hdf_error_silencer&) -> hdf_error_silencer& = delete;
+
+  ~hdf_error_silencer()
+  {
+    H5Eset_auto2(H5E_DEFAULT, func_, data_);
+  }
+
+private:
+  H5E_auto2_t func_;
+  void*       data_;
+};
+
+static auto catalogue_string(const attribute_store& attrs, const char* name) -> std::string
+{
+  auto i = attrs.find(name);
+  return i != attrs.end() && i->type() == attribute::data_type::string ? i->get_string() : std::string{};
+}
+
+static auto catalogue_time(const attribute_store& attrs, const char* date, const char* time) -> int64_t
+{
+  auto d = catalogue_string(attrs, date);
+  auto t = catalogue_string(attrs, time);
+  if (d.empty() || t.empty())
+    return 0;
+  try
+  {
+    return strings_to_time(d, t);
+  }
+  catch (error&)
+  {
+    return 0;
+  }
+}
+
+// open a file and add its records to the catalogue
+static auto catalogue_scan(const catalogue_entry& entry, catalogue_builder& out) -> void
+{
+  // the structure index gathers the layer shapes and quantities in a single pass
+  file::options opts;
+  opts.index_structure = true;
+  file f{entry.path, file::io_mode::read_only, opts};
+
+  catalogue_file rec;
+  rec.path = out.add_string(entry.path.c_str());
+  rec.source = out.add_string(catalogue_string(f.attributes(), "source").c_str());
+  rec.size = entry.size;
+  rec.mtime = entry.mtime;
+  rec.time = catalogue_time(f.attributes(), "date", "time");
+  rec.first_sweep = out.sweeps.size();
+  rec.sweeps = static_cast<uint32_t>(f.dataset_count());
+  rec.object = static_cast<uint32_t>(f.object());
+  const auto nfile = out.files.size();
+  out.files.push_back(rec);
+
+  for (size_t i = 0; i < f.dataset_count(); ++i)
+  {
+    auto dset = f.dataset_open(i);
+    const auto& attrs = dset.attributes();
+
+    catalogue_sweep sweep;
+    sweep.file = nfile;
+    sweep.elangle = std::numeric_limits<double>::quiet_NaN();
+    auto el = attrs.find("elangle");
+    if (el != attrs.end())
+    {
+      auto type = el->type();
+      if (type == attribute::data_type::real)
+        sweep.elangle = el->get_real();
+      else if (type == attribute::data_type::integer)
+        sweep.elangle = el->get_integer();
+    }
+    sweep.start = catalogue_time(attrs, "startdate", "starttime");
+    sweep.first_layer = out.layers.size();
+    sweep.index = static_cast<uint32_t>(i);
+    sweep.layers = static_cast<uint32_t>(dset.data_count());
+    const auto nsweep = out.sweeps.size();
+    out.sweeps.push_back(sweep);
+
+    for (size_t j = 0; j < dset.data_count(); ++j)
+    {
+      auto layer = dset.data_open(j);
+
+      catalogue_layer lrec;
+      lrec.sweep = nsweep;
+      lrec.quantity = out.add_string(catalogue_string(layer.attributes(), "quantity").c_str());
+      lrec.first_dim = out.dims.size();
+      lrec.first_chunk = out.chunks.size();
+      lrec.index = static_cast<uint32_t>(j);
+      lrec.type = static_cast<uint16_t>(layer.type());
+      lrec.rank = static_cast<uint16_t>(layer.rank());
+
+      size_t dims[data::max_rank];
+      layer.dims(dims);
+      out.dims.insert(out.dims.end(), dims, dims + layer.rank());
+      auto extents = layer.storage_extents();
+      out.chunks.insert(out.chunks.end(), extents.begin(), extents.end());
+      lrec.chunks = extents.size();
+      out.layers.push_back(lrec);
+    }
+  }
+}
+
+// copy the records of a file from an existing catalogue
+static auto catalogue_copy(const catalogue_tables& old, const catalogue_file& src, catalogue_builder& out) -> void
+{
+  catalogue_file rec = src;
+  rec.path = out.add_string(old.strings + src.path);
+  rec.source = out.add_string(old.strings + src.source);
+  rec.first_sweep = out.sweeps.size();
+  const auto nfile = out.files.size();
+  out.files.push_back(rec);
+
+  for (uint32_t i = 0; i < src.sweeps; ++i)
+  {
+    auto& s = old.sweeps[src.first_sweep + i];
+    catalogue_sweep sweep = s;
+    sweep.file = nfile;
+    sweep.first_layer = out.layers.size();
+    const auto nsweep = out.sweeps.size();
+    out.sweeps.push_back(sweep);
+
+    for (uint32_t j = 0; j < s.layers; ++j)
+    {
+      auto& l = old.layers[s.first_layer + j];
+      catalogue_layer layer = l;
+      layer.sweep = nsweep;
+      layer.quantity = out.add_string(old.strings + l.quantity);
+      layer.first_dim = out.dims.size();
+      layer.first_chunk = out.chunks.size();
+      out.dims.insert(out.dims.end(), old.dims + l.first_dim, old.dims + l.first_dim + l.rank);
+      out.chunks.insert(out.chunks.end(), old.chunks + l.first_chunk, old.chunks + l.first_chunk + l.chunks);
+      out.layers.push_back(layer);
+    }
+  }
+}
+
+// test whether a source string or one of its comma separated fields matches
+static auto catalogue_source_matches(const char* source, const std::string& want) -> bool
+{
+  if (want.empty() || want == source)
+    return true;
+  for (auto field = source; ; )
+  {
+    auto end = strchr(field, ',');
+    auto len = end ? static_cast<size_t>(end - field) : strlen(field);
+    if (len == want.size() && strncmp(field, want.c_str(), len) == 0)
+      return true;
+    if (!end)
+      return false;
+    field = end + 1;
+  }
+}
+
+auto catalogue::update(const std::string& root, const std::string& path) -> update_stats
+{
+  std::vector<catalogue_entry> found;
+  catalogue_walk(root, found);
+  std::sort(found.begin(), found.end(), [](const catalogue_entry& lhs, const catalogue_entry& rhs)
+  {
+    return lhs.path < rhs.path;
+  });
+
+  update_stats stats{0, 0, 0};
+  catalogue_builder out;
+  {
+    // an existing catalogue which is missing or unreadable is simply rebuilt
+    std::unique_ptr<catalogue> old;
+    catalogue_tables tables;
+    try
+    {
+      old.reset(new catalogue{path});
+      catalogue_locate(old->base_, old->length_, tables);
+    }
+    catch (error&)
+    {
+      old.reset();
+    }
+
+    hdf_error_silencer silence;
+    size_t next = 0;
+    for (auto& entry : found)
+    {
+      // files in the old catalogue are sorted by path, so advance through them in step
+      if (old)
+      {
+        while (next < tables.header->files && strcmp(tables.strings + tables.files[next].path, entry.path.c_str()) < 0)
+          ++next;
+        if (next < tables.header->files)
+        {
+          auto& rec = tables.files[next];
+          if (   strcmp(tables.strings + rec.path, entry.path.c_str()) == 0
+              && rec.size == entry.size
+              && rec.mtime == entry.mtime)
+          {
+            catalogue_copy(tables, rec, out);
+            continue;
+          }
+        }
+      }
+
+      ++stats.scanned;
+      auto mark = out.position();
+      try
+      {
+        catalogue_scan(entry, out);
+      }
+      catch (std::exception&)
+      {
+        out.rewind(mark);
+        ++stats.failed;
+      }
+    }
+  }
+  stats.files = out.files.size();
+
+  catalogue_header hdr;
+  memcpy(hdr.magic, catalogue_magic, sizeof(catalogue_magic));
+  hdr.version = catalogue_version;
+  hdr.byte_order = catalogue_byte_order;
+  hdr.files = out.files.size();
+  hdr.sweeps = out.sweeps.size();
+  hdr.layers = out.layers.size();
+  hdr.dims = out.dims.size();
+  hdr.chunks = out.chunks.size();
+  hdr.strings = out.strings.size();
+
+  auto failed = replace_file(path, {
+        {&hdr, sizeof(hdr)}
+      , {out.files.data(), out.files.size() * sizeof(catalogue_file)}
+      , {out.sweeps.data(), out.sweeps.size() * sizeof(catalogue_sweep)}
+      , {out.layers.data(), out.layers.size() * sizeof(catalogue_layer)}
+      , {out.dims.data(), out.dims.size() * sizeof(uint64_t)}
+      , {out.chunks.data(), out.chunks.size() * sizeof(chunk)}
+      , {out.strings.data(), out.strings.size()}
+      });
+  if (!failed.empty())
+    throw make_error({}, "catalogue write", failed.c_str());
+  return stats;
+}
+
+catalogue::catalogue(const std::string& path)
+  : base_{nullptr}
+  , length_{0}
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    throw make_error({}, "catalogue open", path.c_str());
+  if (!map_file_region(path, 0, static_cast<size_t>(st.st_size), base_, length_))
+    throw make_error({}, "catalogue open", path.c_str(), "failed to map file");
+
+  catalogue_tables tables;
+  if (!catalogue_locate(base_, length_, tables) || !catalogue_validate(tables))
+  {
+    unmap_file_region(base_, length_);
+    throw make_error({}, "catalogue open", path.c_str(), "invalid catalogue");
+  }
+}
+
+catalogue::catalogue(catalogue&& rhs) noexcept
+  : base_{rhs.base_}
+  , length_{rhs.length_}
+{
+  rhs.base_ = nullptr;
+  rhs.length_ = 0;
+}
+
+auto catalogue::operator=(catalogue&& rhs) noexcept -> catalogue&
+{
+  std::swap(base_, rhs.base_);
+  std::swap(length_, rhs.length_);
+  return *this;
+}
+
+catalogue::~catalogue()
+{
+  if (base_)
+    unmap_file_region(base_, length_);
+}
+
+auto catalogue::file_count() const -> size_t
+{
+  return base_ ? static_cast<const catalogue_header*>(base_)->files : 0;
+}
+
+auto catalogue::layer_count() const -> size_t
+{
+  return base_ ? static_cast<const catalogue_header*>(base_)->layers : 0;
+}
+
+auto catalogue::find(const query& q, const std::function<void(const match&)>& fn) const -> size_t
+{
+  catalogue_tables t;
+  if (!base_ || !catalogue_locate(base_, length_, t))
+    return 0;
+
+  const bool any_elangle =
+       q.min_elangle == -std::numeric_limits<double>::infinity()
+    && q.max_elangle == std::numeric_limits<double>::infinity();
+
+  size_t count = 0;
+  match m;
+  for (uint64_t i = 0; i < t.header->files; ++i)
+  {
+    auto& f = t.files[i];
+    if (f.time < q.from || f.time >= q.to || !catalogue_source_matches(t.strings + f.source, q.source))
+      continue;
+    m.path = t.strings + f.path;
+    m.source = t.strings + f.source;
+    m.object = static_cast<file::object_type>(f.object);
+    m.time = static_cast<time_t>(f.time);
+
+    for (uint32_t j = 0; j < f.sweeps; ++j)
+    {
+      auto& s = t.sweeps[f.first_sweep + j];
+      if (!any_elangle && !(s.elangle >= q.min_elangle && s.elangle < q.max_elangle))
+        continue;
+      m.dataset = s.index;
+      m.elangle = s.elangle;
+      m.start = static_cast<time_t>(s.start);
+
+      for (uint32_t k = 0; k < s.layers; ++k)
+      {
+        auto& l = t.layers[s.first_layer + k];
+        if (!q.quantity.empty() && q.quantity != t.strings + l.quantity)
+          continue;
+        m.layer = l.index;
+        m.quantity = t.strings + l.quantity;
+        m.type = static_cast<data::data_type>(l.type);
+        m.rank = l.rank;
+        m.dims = t.dims + l.first_dim;
+        m.chunk_count = l.chunks;
+        m.chunks = t.chunks + l.first_chunk;
+        fn(m);
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+// dataset which is being loaded by load_batch() and has not yet been delivered
+template <typename T>
+struct batch_pending
+{
+  batch_dataset<T>                dset;
+  std::vector<std::future<void>>  done;
+  size_t                          bytes;
+};
+
+template <typename T>
+auto odim_h5::load_batch(
+      const std::vector<std::string>& paths
+    , const batch_selection& selection
+    , T undetect
+    , T nodata
+    , const std::function<void(batch_dataset<T>&)>& consumer
+    ) -> void
+{
+  std::deque<batch_pending<T>> pending;
+  size_t used = 0;
+
+  // wait for the oldest dataset and hand it to the consumer
+  auto deliver = [&]
+  {
+    auto& front = pending.front();
+    for (auto& f : front.done)
+      f.get();
+    consumer(front.dset);
+    used -= front.bytes;
+    pending.pop_front();
+  };
+
+  auto selected = [&](const std::string& quantity)
+  {
+    return selection.quantities.empty()
+      || std::find(selection.quantities.begin(), selection.quantities.end(), quantity) != selection.quantities.end();
+  };
+
+  try
+  {
+    std::vector<size_t> all;
+    for (size_t n = 0; n < paths.size(); ++n)
+    {
+      file f{paths[n], file::io_mode::read_only, selection.options};
+
+      auto& indexes = selection.datasets.empty() ? all : selection.datasets;
+      if (selection.datasets.empty())
+      {
+        all.resize(f.dataset_count());
+        for (size_t i = 0; i < all.size(); ++i)
+          all[i] = i;
+      }
+
+      for (auto i : indexes)
+      {
+        if (i >= f.dataset_count())
+          continue;
+
+        // the dataset is queued before any reads start so that errors always wait for them
+        auto dset = f.dataset_open(i);
+        pending.emplace_back();
+        auto& item = pending.back();
+        item.dset.file = n;
+        item.dset.index = i;
+        item.bytes = 0;
+
+        for (size_t j = 0; j < dset.data_count(); ++j)
+        {
+          auto layer = dset.data_open(j);
+          auto quantity = layer.quantity();
+          if (!selected(quantity))
+            continue;
+
+          // apply back pressure before allocating the output for this layer
+          const auto bytes = layer.size() * sizeof(T);
+          while (pending.size() > 1 && used + bytes > selection.memory_budget)
+            deliver();
+
+          item.dset.layers.emplace_back();
+          auto& out = item.dset.layers.back();
+          out.index = j;
+          out.quantity = std::move(quantity);
+          out.dims.resize(layer.rank());
+          layer.dims(out.dims.data());
+          out.values.resize(layer.size());
+          item.bytes += bytes;
+          used += bytes;
+          item.done.push_back(layer.read_unpack_async(out.values.data(), undetect, nodata));
+        }
+
+        if (item.dset.layers.empty())
+        {
+          pending.pop_back();
+          continue;
+        }
+
+        // deliver anything which has already finished without blocking
+        while (!pending.empty())
+        {
+          auto ready = std::all_of(pending.front().done.begin(), pending.front().done.end(), [](const std::future<void>& f)
+          {
+            return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+          });
+          if (!ready)
+            break;
+          deliver();
+        }
+      }
+    }
+
+    while (!pending.empty())
+      deliver();
+  }
+  catch (...)
+  {
+    // outstanding jobs write into the pending buffers so they must finish first
+    for (auto& item : pending)
+      for (auto& f : item.done)
+        if (f.valid())
+          f.wait();
+    throw;
+  }
+}
+
+template auto odim_h5::load_batch<char>(const std::vector<std::string>& paths, const batch_selection& selection, char undetect, char nodata, const std::function<void(batch_dataset<char>&)>& consumer) -> void;
+template auto odim_h5::load_batch<signed char>(const std::vector<std::string>& paths, const batch_selection& selection, signed char undetect, signed char nodata, const std::function<void(batch_dataset<signed char>&)>& consumer) -> void;
+template auto odim_h5::load_batch<unsigned char>(const std::vector<std::string>& paths, const batch_selection& selection, unsigned char undetect, unsigned char nodata, const std::function<void(batch_dataset<unsigned char>&)>& consumer) -> void;
+template auto odim_h5::load_batch<short>(const std::vector<std::string>& paths, const batch_selection& selection, short undetect, short nodata, const std::function<void(batch_dataset<short>&)>& consumer) -> void;
+template auto odim_h5::load_batch<unsigned short>(const std::vector<std::string>& paths, const batch_selection& selection, unsigned short undetect, unsigned short nodata, const std::function<void(batch_dataset<unsigned short>&)>& consumer) -> void;
+template auto odim_h5::load_batch<int>(const std::vector<std::string>& paths, const batch_selection& selection, int undetect, int nodata, const std::function<void(batch_dataset<int>&)>& consumer) -> void;
+template auto odim_h5::load_batch<unsigned int>(const std::vector<std::string>& paths, const batch_selection& selection, unsigned int undetect, unsigned int nodata, const std::function<void(batch_dataset<unsigned int>&)>& consumer) -> void;
+template auto odim_h5::load_batch<long>(const std::vector<std::string>& paths, const batch_selection& selection, long undetect, long nodata, const std::function<void(batch_dataset<long>&)>& consumer) -> void;
+template auto odim_h5::load_batch<unsigned long>(const std::vector<std::string>& paths, const batch_selection& selection, unsigned long undetect, unsigned long nodata, const std::function<void(batch_dataset<unsigned long>&)>& consumer) -> void;
+template auto odim_h5::load_batch<long long>(const std::vector<std::string>& paths, const batch_selection& selection, long long undetect, long long nodata, const std::function<void(batch_dataset<long long>&)>& consumer) -> void;
+template auto odim_h5::load_batch<unsigned long long>(const std::vector<std::string>& paths, const batch_selection& selection, unsigned long long undetect, unsigned long long nodata, const std::function<void(batch_dataset<unsigned long long>&)>& consumer) -> void;
+template auto odim_h5::load_batch<float>(const std::vector<std::string>& paths, const batch_selection& selection, float undetect, float nodata, const std::function<void(batch_dataset<float>&)>& consumer) -> void;
+template auto odim_h5::load_batch<double>(const std::vector<std::string>& paths, const batch_selection& selection, double undetect, double nodata, const std::function<void(batch_dataset<double>&)>& consumer) -> void;
+template auto odim_h5::load_batch<long double>(const std::vector<std::string>& paths, const batch_selection& selection, long double undetect, long double nodata, const std::function<void(batch_dataset<long double>&)>& consumer) -> void;
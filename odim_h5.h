@@ -19,9 +19,13 @@
 #define ODIM_H5_H
 
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -33,6 +37,20 @@ namespace odim_h5
   /// Get the default ODIM_H5 conventions version used
   auto default_odim_version() -> std::pair<int, int>;
 
+  /// Get the number of threads in the library worker pool
+  /**
+   * The worker pool is used to decompress and unpack chunks for the parallel
+   * read functions.  Worker threads never call into the HDF5 library.  By
+   * default the pool has one thread per hardware thread.
+   */
+  auto worker_threads() -> size_t;
+
+  /// Set the number of threads in the library worker pool
+  /**
+   * This function must not be called while parallel operations are in progress.
+   */
+  auto set_worker_threads(size_t count) -> void;
+
   // Internal - RAII object for managing an HDF5 API hid_t
   struct handle
   {
@@ -57,6 +75,9 @@ namespace odim_h5
     auto close() -> void;
   };
 
+  // Internal - node of the in-memory structure index of a file
+  struct structure_node;
+
   /// Exception thrown to indicate I/O errors
   class error : public std::runtime_error
   {
@@ -64,6 +85,8 @@ namespace odim_h5
     error(const char* what);
   };
 
+  class attribute_store;
+
   /// Attribute handle
   class attribute
   {
@@ -117,15 +140,22 @@ namespace odim_h5
     auto set(const std::vector<double>& val) -> void;
 
   private:
-    attribute(const handle* parent, std::string name, bool existing);
+    attribute(const handle* parent, std::string name, bool existing, const attribute_store* owner = nullptr);
     auto open(handle* type_out = nullptr) const -> handle;
     auto open_or_create(data_type type, size_t size, handle* type_out = nullptr) -> handle;
+    auto load() const -> void;
+    auto cached() const -> bool;
 
   private:
-    const handle*     parent_;
-    std::string       name_;
-    mutable data_type type_;
-    mutable size_t    size_;      // number of elements in array or characters in string
+    const handle*               parent_;
+    const attribute_store*      owner_;     // store notified before the value changes (if any)
+    std::string                 name_;
+    mutable data_type           type_;
+    mutable size_t              size_;      // number of elements in array or characters in string
+    bool                        cache_;     // value is cached in memory and kept coherent by setters
+    mutable std::string         str_;       // cached string value
+    mutable std::vector<long>   ints_;      // cached integer value(s)
+    mutable std::vector<double> reals_;     // cached real value(s)
 
     friend class attribute_store;
     friend class data;
@@ -139,6 +169,14 @@ namespace odim_h5
     typedef std::vector<attribute> store_impl;
 
   public:
+    /// Policy used to load the attributes of a group when it is opened
+    enum class load_policy
+    {
+        names       ///< Read attribute names only, each getter reads its value from the file
+      , snapshot    ///< Read and cache all attribute values, getters are served from memory
+      , deferred    ///< As for names, but wait until the attributes are first used
+    };
+
     /// Iterator used for traversing the store
     typedef store_impl::iterator iterator;
     /// Constant iterator used for traversing the store
@@ -149,43 +187,46 @@ namespace odim_h5
     typedef store_impl::const_reverse_iterator const_reverse_iterator;
 
   public:
+    /// Get the policy used to load attributes
+    auto policy() const noexcept -> load_policy                 { return policy_; }
+
     /// Get the number of attributes in the store
-    auto size() const noexcept -> size_t                        { return attrs_.size(); }
+    auto size() const -> size_t                                 { ensure_loaded(); return attrs_.size(); }
 
     /// Get an iterator to the first attribute in the store
-    auto begin() noexcept -> iterator                           { return attrs_.begin(); }
+    auto begin() -> iterator                                    { ensure_loaded(); return attrs_.begin(); }
     /// Get an iterator to the first attribute in the store
-    auto begin() const noexcept -> const_iterator               { return attrs_.begin(); }
+    auto begin() const -> const_iterator                        { ensure_loaded(); return attrs_.begin(); }
     /// Get an iterator to the first attribute in the store
-    auto cbegin() const noexcept -> const_iterator              { return attrs_.begin(); }
+    auto cbegin() const -> const_iterator                       { ensure_loaded(); return attrs_.begin(); }
     /// Get an iterator to the first attribute in the store (reversed)
-    auto rbegin() noexcept -> reverse_iterator                  { return attrs_.rbegin(); }
+    auto rbegin() -> reverse_iterator                           { ensure_loaded(); return attrs_.rbegin(); }
     /// Get an iterator to the first attribute in the store (reversed)
-    auto rbegin() const noexcept -> const_reverse_iterator      { return attrs_.rbegin(); }
+    auto rbegin() const -> const_reverse_iterator               { ensure_loaded(); return attrs_.rbegin(); }
     /// Get an iterator to the first attribute in the store (reversed)
-    auto crbegin() const noexcept -> const_reverse_iterator     { return attrs_.rbegin(); }
+    auto crbegin() const -> const_reverse_iterator              { ensure_loaded(); return attrs_.rbegin(); }
 
     /// Get an iterator referring to the past-the-end attribute in the store
-    auto end() noexcept -> iterator                             { return attrs_.end(); }
+    auto end() -> iterator                                      { ensure_loaded(); return attrs_.end(); }
     /// Get an iterator referring to the past-the-end attribute in the store
-    auto end() const noexcept -> const_iterator                 { return attrs_.end(); }
+    auto end() const -> const_iterator                          { ensure_loaded(); return attrs_.end(); }
     /// Get an iterator referring to the past-the-end attribute in the store
-    auto cend() const noexcept -> const_iterator                { return attrs_.end(); }
+    auto cend() const -> const_iterator                         { ensure_loaded(); return attrs_.end(); }
     /// Get an iterator referring to the past-the-end attribute in the store (reversed)
-    auto rend() noexcept -> reverse_iterator                    { return attrs_.rend(); }
+    auto rend() -> reverse_iterator                             { ensure_loaded(); return attrs_.rend(); }
     /// Get an iterator referring to the past-the-end attribute in the store (reversed)
-    auto rend() const noexcept -> const_reverse_iterator        { return attrs_.rend(); }
+    auto rend() const -> const_reverse_iterator                 { ensure_loaded(); return attrs_.rend(); }
     /// Get an iterator referring to the past-the-end attribute in the store (reversed)
-    auto crend() const noexcept -> const_reverse_iterator       { return attrs_.rend(); }
+    auto crend() const -> const_reverse_iterator                { ensure_loaded(); return attrs_.rend(); }
 
     /// Find an attribute by name
-    auto find(const char* name) noexcept -> iterator;
+    auto find(const char* name) -> iterator;
     /// Find an attribute by name
-    auto find(const char* name) const noexcept -> const_iterator;
+    auto find(const char* name) const -> const_iterator;
     /// Find an attribute by name
-    auto find(const std::string& name) noexcept -> iterator;
+    auto find(const std::string& name) -> iterator;
     /// Find an attribute by name
-    auto find(const std::string& name) const noexcept -> const_iterator;
+    auto find(const std::string& name) const -> const_iterator;
 
     /// Get an attribute by name and create if not found
     auto operator[](const char* name) -> attribute&;
@@ -202,8 +243,8 @@ namespace odim_h5
     auto erase(const std::string& name) -> void;
 
   protected:
-    attribute_store(handle::id_t hnd, bool existing);
-    attribute_store(const handle& parent, const char* name, size_t index, bool existing);
+    attribute_store(handle::id_t hnd, bool existing, load_policy policy);
+    attribute_store(const attribute_store& parent, const char* name, size_t index, bool existing);
 
     attribute_store(const attribute_store& rhs);
     attribute_store(attribute_store&& rhs) noexcept;
@@ -213,12 +254,31 @@ namespace odim_h5
 
     auto fix_attribute_parents(const attribute_store& old) -> void;
 
+    /// Called before the named attribute is written or erased
+    virtual auto attribute_changed(const std::string& name) const noexcept -> void;
+
+    auto ensure_loaded() const -> void                          { if (!loaded_) load(); }
+    auto load() const -> void;
+
+    auto index_find(const char* name) const noexcept -> size_t;
+    auto index_build() const -> void;
+    auto index_insert(size_t pos) -> void;
+    auto index_erase(size_t pos) -> void;
+
   protected:
-    handle      hnd_;
-    handle      what_;
-    handle      where_;
-    handle      how_;
-    store_impl  attrs_;
+    handle                      hnd_;
+    mutable handle              what_;
+    mutable handle              where_;
+    mutable handle              how_;
+    mutable store_impl          attrs_;
+    mutable std::vector<size_t> index_;     // positions in attrs_ sorted by attribute name
+    mutable bool                loaded_;    // attributes have been enumerated
+    load_policy                 policy_;
+
+    std::shared_ptr<const structure_node> structure_;   // structure index of the file (if built)
+    const structure_node*                 node_;        // index node of this group (if indexed)
+
+    friend class attribute;
   };
 
   /// Base class for ODIM_H5 objects with 'what', 'where' and 'how' attributes
@@ -236,8 +296,8 @@ namespace odim_h5
     virtual auto is_api_attribute(const std::string& name) const -> bool;
 
   protected:
-    group(handle::id_t hnd, bool existing);
-    group(const handle& parent, const char* name, size_t index, bool existing);
+    group(handle::id_t hnd, bool existing, load_policy policy);
+    group(const attribute_store& parent, const char* name, size_t index, bool existing);
   };
 
   /// Dataset object
@@ -266,6 +326,212 @@ namespace odim_h5
     /// Default compression level
     constexpr static int default_compression = 6;
 
+    /// Storage layout policy used when creating a data or quality layer
+    class layout
+    {
+    public:
+      /// Layout strategies
+      enum class strategy
+      {
+          automatic     ///< Select a layout based on the size of the layer
+        , chunk_shape   ///< Chunked storage using an explicit chunk shape
+        , chunk_rays    ///< Chunked storage using a fixed number of rays (rows) per chunk
+        , contiguous    ///< Contiguous storage (compression is not supported)
+        , compact       ///< Compact storage in the object header (tiny uncompressed layers only)
+      };
+
+    public:
+      /// Construct an automatic layout policy
+      layout() : strategy_{strategy::automatic}, rays_{0} { }
+
+      /// Select the layout automatically based on the number of elements in the layer
+      static auto automatic() -> layout;
+      /// Use chunked storage with an explicit chunk shape (rank elements)
+      static auto chunked(size_t rank, const size_t* dims) -> layout;
+      /// Use chunked storage where each chunk holds the given number of rays
+      /**
+       * The count is clamped to the number of rays in the layer.  An error is
+       * thrown if count is zero.
+       */
+      static auto rays(size_t count) -> layout;
+      /// Use contiguous storage
+      static auto contiguous() -> layout;
+      /// Use compact storage
+      static auto compact() -> layout;
+
+      /// Get the layout strategy
+      auto kind() const -> strategy                             { return strategy_; }
+
+    private:
+      strategy            strategy_;
+      size_t              rays_;
+      std::vector<size_t> chunk_;
+
+      friend class data;
+    };
+
+    /// Compression filter pipeline used when creating a data or quality layer
+    /**
+     * An integer compression level converts implicitly to deflate at that level,
+     * with values of zero or less disabling compression.  The LZ4 and Zstandard
+     * codecs use the standard registered HDF5 filter identifiers (32004 and
+     * 32015) and require the corresponding filter plugin to be available at
+     * runtime.  If it is not, the layer is compressed using deflate at the
+     * default level instead.  The byte shuffle filter is ignored when no codec
+     * is selected.
+     */
+    class compression_options
+    {
+    public:
+      /// Compression codecs
+      enum class codec
+      {
+          none      ///< No compression
+        , deflate   ///< Deflate (zlib)
+        , lz4       ///< LZ4 (HDF5 filter 32004)
+        , zstd      ///< Zstandard (HDF5 filter 32015)
+      };
+
+    public:
+      /// Use deflate at the given level, or no compression if level is zero or less
+      compression_options(int level = default_compression)
+        : codec_{level > 0 ? codec::deflate : codec::none}, level_{level > 0 ? level : 0}, shuffle_{false} { }
+
+      /// No compression
+      static auto none() -> compression_options;
+      /// Deflate at the given level (1-9)
+      static auto deflate(int level = default_compression, bool shuffle = false) -> compression_options;
+      /// LZ4 compression
+      static auto lz4(bool shuffle = true) -> compression_options;
+      /// Zstandard at the given level (1-22)
+      static auto zstd(int level = 3, bool shuffle = true) -> compression_options;
+
+      /// Check whether a codec is available for writing
+      static auto available(codec type) -> bool;
+
+      /// Get the codec
+      auto type() const -> codec                                { return codec_; }
+      /// Get the compression level
+      auto level() const -> int                                 { return level_; }
+      /// Get whether the byte shuffle filter is applied before compression
+      auto shuffle() const -> bool                              { return shuffle_; }
+
+    private:
+      compression_options(codec type, int level, bool shuffle)
+        : codec_{type}, level_{level}, shuffle_{type != codec::none && shuffle} { }
+
+    private:
+      codec codec_;
+      int   level_;
+      bool  shuffle_;
+    };
+
+    /// Built-in value test used by the vectorised write_pack to detect undetect and nodata
+    class pack_test
+    {
+    public:
+      /// Test kinds
+      enum class kind
+      {
+          never           ///< Never matches
+        , is_nan          ///< Matches NaN values
+        , less            ///< Matches values less than the threshold
+        , less_equal      ///< Matches values less than or equal to the threshold
+        , greater         ///< Matches values greater than the threshold
+        , greater_equal   ///< Matches values greater than or equal to the threshold
+        , equal           ///< Matches values equal to the threshold
+      };
+
+    public:
+      /// Construct a test which never matches
+      pack_test() : kind_{kind::never}, threshold_{0.0} { }
+
+      /// Test which never matches
+      static auto never() -> pack_test                          { return {kind::never, 0.0}; }
+      /// Test for NaN values
+      static auto is_nan() -> pack_test                         { return {kind::is_nan, 0.0}; }
+      /// Test for values less than a threshold
+      static auto less(double val) -> pack_test                 { return {kind::less, val}; }
+      /// Test for values less than or equal to a threshold
+      static auto less_equal(double val) -> pack_test           { return {kind::less_equal, val}; }
+      /// Test for values greater than a threshold
+      static auto greater(double val) -> pack_test              { return {kind::greater, val}; }
+      /// Test for values greater than or equal to a threshold
+      static auto greater_equal(double val) -> pack_test        { return {kind::greater_equal, val}; }
+      /// Test for values equal to a threshold
+      static auto equal(double val) -> pack_test                { return {kind::equal, val}; }
+
+      /// Get the test kind
+      auto type() const -> kind                                 { return kind_; }
+      /// Get the test threshold
+      auto threshold() const -> double                          { return threshold_; }
+
+    private:
+      pack_test(kind k, double threshold) : kind_{k}, threshold_{threshold} { }
+
+    private:
+      kind    kind_;
+      double  threshold_;
+    };
+
+    /// Summary of the values packed by write_pack
+    struct pack_summary
+    {
+      size_t  valid;    ///< Number of values which were neither undetect nor nodata
+      double  min;      ///< Minimum valid (unpacked) input value, NaN if there are none
+      double  max;      ///< Maximum valid (unpacked) input value, NaN if there are none
+    };
+
+    /// Read only view of an uncompressed contiguous layer mapped directly from the file
+    /**
+     * The view refers to the layer bytes in the operating system page cache and
+     * remains valid after the data and file objects are destroyed.  Changes
+     * made to the layer through the library while the view exists are visible
+     * through it.  The packing parameters are captured when the view is created.
+     */
+    class mapped_view
+    {
+    public:
+      /// Construct an empty view
+      mapped_view() noexcept;
+      mapped_view(const mapped_view& rhs) = delete;
+      mapped_view(mapped_view&& rhs) noexcept;
+      auto operator=(const mapped_view& rhs) -> mapped_view& = delete;
+      auto operator=(mapped_view&& rhs) noexcept -> mapped_view&;
+      ~mapped_view();
+
+      /// Check whether the view refers to a layer
+      explicit operator bool() const noexcept                   { return base_ != nullptr; }
+
+      /// Get the storage type of the mapped layer
+      auto type() const noexcept -> data_type                   { return type_; }
+      /// Get the number of elements in the mapped layer
+      auto size() const noexcept -> size_t                      { return size_; }
+      /// Get the address of the first element of the mapped layer
+      auto bytes() const noexcept -> const void*                { return data_; }
+
+      /// Get a typed pointer to the stored values
+      /**
+       * T must have the same representation as the storage type of the layer.
+       */
+      template <typename T>
+      auto values() const -> const T*;
+
+      /// Unpack a range of elements from the mapping, replace nodata and undetect with user values
+      template <typename T>
+      auto unpack(T* data, T undetect, T nodata, size_t offset = 0, size_t count = size_t(-1)) const -> void;
+
+    private:
+      void*       base_;      // start of the mapping (page aligned)
+      size_t      length_;    // length of the mapping
+      const void* data_;      // first element of the layer
+      data_type   type_;
+      size_t      size_;
+      double      params_[4]; // gain, offset, nodata, undetect
+
+      friend class data;
+    };
+
   public:
     /// Get the number of quality layers
     auto quality_count() const -> size_t                        { return size_quality_; }
@@ -276,17 +542,18 @@ namespace odim_h5
           data_type type
         , size_t rank
         , const size_t* dims
-        , int compression = default_compression
+        , const compression_options& compression = default_compression
+        , const layout& storage = layout{}
         ) -> data;
 
     /// Get the type used to store dataset in file
-    auto type() const -> data_type;
+    auto type() const -> data_type                              { return type_; }
     /// Get the number of dimensions used by the dataset
-    auto rank() const -> size_t;
+    auto rank() const -> size_t                                 { return dims_.size(); }
     /// Get the size of each dataset dimension
     auto dims(size_t* val) const -> size_t;
     /// Get the total number of points in the dataset
-    auto size() const -> size_t;
+    auto size() const -> size_t                                 { return size_; }
 
     /// Get the quantity identifier
     auto quantity() const -> std::string;
@@ -321,81 +588,316 @@ namespace odim_h5
     template <typename T>
     auto read(T* data) const -> void;
 
+    /// Read a hyperslab of the dataset without unpacking
+    /**
+     * The start, count and stride arrays must each contain rank() elements.  The
+     * output buffer must be large enough to hold the product of the count array.
+     *
+     * \param data    Output buffer
+     * \param start   Index of first element to read in each dimension
+     * \param count   Number of elements to read in each dimension
+     * \param stride  Step between elements in each dimension (nullptr for contiguous)
+     */
+    template <typename T>
+    auto read(T* data, const size_t* start, const size_t* count, const size_t* stride = nullptr) const -> void;
+
     /// Unpack and read the dataset, replace nodata and undetect with user values
+    /**
+     * The layer is read in its native storage type and unpacked by a kernel
+     * specialised for the storage and output type pair.  The nodata and
+     * undetect tests are therefore exact comparisons against packed values.
+     *
+     * Layers stored as 8 or 16 bit integers are unpacked using a lookup table
+     * of every possible packed code.  Tables are cached by their packing
+     * parameters so that identically packed layers share the same table.
+     */
     template <typename T>
     auto read_unpack(T* data, T undetect, T nodata) const -> void;
 
+    /// Unpack and read a hyperslab of the dataset, replace nodata and undetect with user values
+    /**
+     * Parameters are as for the hyperslab version of read().  Only the selected
+     * elements are read from the file and unpacked.
+     */
+    template <typename T>
+    auto read_unpack(
+          T* data
+        , T undetect
+        , T nodata
+        , const size_t* start
+        , const size_t* count
+        , const size_t* stride = nullptr
+        ) const -> void;
+
+    /// Read the dataset without unpacking, decompressing chunks in parallel
+    /**
+     * Raw chunks are fetched on the calling thread using direct chunk reads and
+     * decompressed on the library worker pool, outside of the HDF5 library.
+     * Layers which are not chunked, use filters other than shuffle and deflate or
+     * are not stored in native byte order are read using read() instead, as are
+     * all layers when built against HDF5 older than 1.10.2.  Stored
+     * values are converted to T using a plain cast.
+     */
+    template <typename T>
+    auto read_parallel(T* data) const -> void;
+
+    /// Unpack and read the dataset, decompressing and unpacking chunks in parallel
+    /**
+     * As for read_parallel(), but each chunk is also unpacked on the worker pool
+     * using the same kernels as read_unpack().
+     */
+    template <typename T>
+    auto read_unpack_parallel(T* data, T undetect, T nodata) const -> void;
+
+    /// Read the dataset without unpacking asynchronously
+    /**
+     * Raw chunks are fetched on the calling thread, since the HDF5 library may
+     * only be used from one thread at a time, and are decompressed on the library
+     * worker pool after the call returns.  Decoding of the first chunks starts
+     * while the remaining chunks are still being fetched.  Layers which cannot be
+     * decoded outside of the HDF5 library are read before the call returns.  The
+     * output buffer must remain valid until the returned future is ready.  Errors
+     * are reported through the future.
+     */
+    template <typename T>
+    auto read_async(T* data) const -> std::future<void>;
+
+    /// Unpack and read the dataset asynchronously, replace nodata and undetect with user values
+    /**
+     * As for read_async(), but chunks are also unpacked on the worker pool.  For
+     * layers which cannot be decoded outside of the HDF5 library only the
+     * unpacking is performed asynchronously.
+     */
+    template <typename T>
+    auto read_unpack_async(T* data, T undetect, T nodata) const -> std::future<void>;
+
+    /// Check whether the layer can be memory mapped by map_view()
+    /**
+     * Only layers stored contiguously, without filters, in native byte order and
+     * in a file opened from disk using the default driver can be mapped.
+     */
+    auto mappable() const -> bool;
+
+    /// Map the layer read only directly from the file without copying
+    auto map_view() const -> mapped_view;
+
+    /// Location of a block of stored layer bytes within the file
+    struct extent
+    {
+      uint64_t  offset;   ///< Byte offset from the start of the file
+      uint64_t  size;     ///< Number of stored (possibly compressed) bytes
+    };
+
+    /// Get the location in the file of each stored chunk of the layer
+    /**
+     * Contiguous layers return a single extent.  Compact layers and storage
+     * which has not been allocated return no extents.  Chunk locations require
+     * HDF5 1.10.5 or later and are not returned when built against older
+     * versions.
+     */
+    auto storage_extents() const -> std::vector<extent>;
+
     /// Write the dataset without packing
     template <typename T>
     auto write(const T* data) -> void;
 
+    /// Write a hyperslab of the dataset without packing
+    /**
+     * Parameters are as for the hyperslab version of read().
+     */
+    template <typename T>
+    auto write(const T* data, const size_t* start, const size_t* count, const size_t* stride = nullptr) -> void;
+
     /// Pack and write the dataset, use passed functors to test for undetect and nodata
+    /**
+     * Values are packed directly into the storage type and written one chunk at
+     * a time, or one block of rays at a time for unchunked layers and chunks
+     * larger than the 256 KiB stream buffer, so the memory overhead is bounded by
+     * the block size rather than the size of the layer.
+     * Packed values are truncated and saturated to the range of the storage type.
+     */
     template <typename T, class UndetectTest, class NoDataTest>
     auto write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata) -> void;
 
+    /// Pack and write the dataset using a vectorised kernel and built-in undetect and nodata tests
+    /**
+     * This version of write_pack is available for float and double input.  Values
+     * are scaled using the reciprocal of gain, rounded to the nearest integer and
+     * saturated to the range of the storage type.  The extremes of the storage
+     * range are not used for valid data if they are occupied by the nodata or
+     * undetect values.  SIMD kernels are selected at runtime when the CPU supports
+     * them.  As with the functor version, the layer is packed and written one
+     * chunk or block of rays at a time.
+     *
+     * \return  Count and range of the valid input values
+     */
+    template <typename T>
+    auto write_pack(const T* data, pack_test is_undetect, pack_test is_nodata) -> pack_summary;
+
+    /// Write the dataset without packing, compressing chunks in parallel
+    /**
+     * Chunks are converted to the storage type and deflated on the library worker
+     * pool, then committed in order on the calling thread using direct chunk
+     * writes.  The result is identical in format to a layer written by write().
+     * Layers which are not chunked, use filters other than shuffle and deflate or
+     * are not stored in native byte order are written using write() instead, as
+     * are all layers when built against HDF5 older than 1.10.2.
+     * Values outside the range of the storage type are saturated.
+     */
+    template <typename T>
+    auto write_parallel(const T* data) -> void;
+
+    /// Pack and write the dataset, packing and compressing chunks in parallel
+    /**
+     * As for write_parallel(), but each chunk is packed on the worker pool using
+     * the same kernels as the pack_test version of write_pack().
+     *
+     * \return  Count and range of the valid input values
+     */
+    template <typename T>
+    auto write_pack_parallel(const T* data, pack_test is_undetect, pack_test is_nodata) -> pack_summary;
+
+  protected:
+    // callback used to pack a block of elements into the storage type during write_streamed()
+    typedef void (*pack_block_fn)(void* context, size_t offset, size_t count, void* out);
+
+    template <typename S, typename T, class UndetectTest, class NoDataTest>
+    static auto pack_block(
+          const T* in
+        , void* out
+        , size_t count
+        , UndetectTest& is_undetect
+        , NoDataTest& is_nodata
+        , const double* params
+        ) -> void;
+
+    auto write_streamed(data_type type, pack_block_fn pack, void* context) -> void;
+
+    auto read_native(
+          data_type type
+        , void* buf
+        , const size_t* start
+        , const size_t* count
+        , const size_t* stride
+        ) const -> void;
+
   protected:
-    data(const handle& parent, bool quality, size_t index);
+    data(const attribute_store& parent, bool quality, size_t index);
     data(
-          const handle& parent
+          const attribute_store& parent
         , bool quality
         , size_t index
         , data_type type
         , size_t rank
         , const size_t* dims
-        , int compression);
+        , const compression_options& compression
+        , const layout& storage);
+
+    auto load_shape() -> void;
+    auto attribute_changed(const std::string& name) const noexcept -> void override;
+    auto cached_real(unsigned int flag, double& val, const char* name) const -> double;
+    auto store_real(unsigned int flag, double& val, const char* name, double set) -> void;
 
   protected:
-    size_t  size_quality_;
-    handle  data_;
+    size_t                size_quality_;
+    handle                data_;
+    data_type             type_;        // cached storage type
+    std::vector<size_t>   dims_;        // cached dimensions
+    size_t                size_;        // cached number of elements
+    mutable unsigned int  cached_;      // flags indicating which packing parameters are cached
+    mutable double        gain_;
+    mutable double        offset_;
+    mutable double        nodata_;
+    mutable double        undetect_;
 
     friend class dataset;
   };
 
-  template <typename T>
-  auto data::read_unpack(T* data, T undetect, T nodata) const -> void
+  template <typename T, class UndetectTest, class NoDataTest>
+  auto data::write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata) -> void
   {
-    read(data);
-
-    const T nd = this->nodata();
-    const T ud = this->undetect();
-    const auto a = gain();
-    const auto b = offset();
-    const auto size = this->size();
+    struct pack_context
+    {
+      const T*        data;
+      UndetectTest&   is_undetect;
+      NoDataTest&     is_nodata;
+      data_type       type;
+      double          params[4];  // gain, offset, undetect, nodata
+    };
+    pack_context ctx{data, is_undetect, is_nodata, type(), { gain(), offset(), undetect(), nodata() }};
 
-    for (size_t i = 0; i < size; ++i)
+    write_streamed(ctx.type, [](void* context, size_t offset, size_t count, void* out)
     {
-      // TODO - if T is a floating point, then the == operations below are unsafe
-      //      - should introduce a tolerance, or if store type is int, read as int and convert to T
-      if (data[i] == ud)
-        data[i] = undetect;
-      else if (data[i] == nd)
-        data[i] = nodata;
-      else
-        data[i] = a * data[i] + b;
-    }
+      auto c = static_cast<pack_context*>(context);
+      auto in = c->data + offset;
+      switch (c->type)
+      {
+      case data_type::i8:
+        return pack_block<int8_t>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      case data_type::u8:
+        return pack_block<uint8_t>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      case data_type::i16:
+        return pack_block<int16_t>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      case data_type::u16:
+        return pack_block<uint16_t>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      case data_type::i32:
+        return pack_block<int32_t>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      case data_type::u32:
+        return pack_block<uint32_t>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      case data_type::i64:
+        return pack_block<int64_t>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      case data_type::u64:
+        return pack_block<uint64_t>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      case data_type::f32:
+        return pack_block<float>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      case data_type::f64:
+        return pack_block<double>(in, out, count, c->is_undetect, c->is_nodata, c->params);
+      default:
+        return;
+      }
+    }, &ctx);
   }
 
-  template <typename T, class UndetectTest, class NoDataTest>
-  auto data::write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata) -> void
+  template <typename S, typename T, class UndetectTest, class NoDataTest>
+  auto data::pack_block(
+        const T* in
+      , void* out
+      , size_t count
+      , UndetectTest& is_undetect
+      , NoDataTest& is_nodata
+      , const double* params
+      ) -> void
   {
-    const T nd = nodata();
-    const T ud = undetect();
-    const auto a = gain();
-    const auto b = offset();
-    const auto size = this->size();
-
-    std::unique_ptr<T[]> buf{new T[size]};
-    for (size_t i = 0; i < size; ++i)
+    const auto a = params[0];
+    const auto b = params[1];
+    const S ud = static_cast<S>(params[2]);
+    const S nd = static_cast<S>(params[3]);
+
+    // integer storage is saturated to the range of the type (NaN maps to the lowest value)
+    const bool saturate = std::is_integral<S>::value;
+    const double lo = static_cast<double>(std::numeric_limits<S>::lowest());
+    const double hi = static_cast<double>(std::numeric_limits<S>::max());
+
+    auto buf = static_cast<S*>(out);
+    for (size_t i = 0; i < count; ++i)
     {
-      if (is_undetect(data[i]))
+      if (is_undetect(in[i]))
         buf[i] = ud;
-      else if (is_nodata(data[i]))
+      else if (is_nodata(in[i]))
         buf[i] = nd;
       else
-        buf[i] = (data[i] - b) / a;
+      {
+        double val = (in[i] - b) / a;
+        if (!saturate)
+          buf[i] = static_cast<S>(val);
+        else if (!(val >= lo))
+          buf[i] = std::numeric_limits<S>::lowest();
+        else if (val >= hi)
+          buf[i] = std::numeric_limits<S>::max();
+        else
+          buf[i] = static_cast<S>(val);
+      }
     }
-
-    write(buf.get());
   }
 
   /// Dataset group which contains data and optional quality layers
@@ -411,9 +913,30 @@ namespace odim_h5
           data::data_type type
         , size_t rank
         , const size_t* dims
-        , int compression = data::default_compression
+        , const data::compression_options& compression = data::default_compression
+        , const data::layout& storage = data::layout{}
         ) -> data;
 
+    /// Find the first data layer with the given quantity
+    /**
+     * When the file was opened with a structure index the lookup is served from
+     * memory, otherwise the quantity of each layer is read in turn.
+     *
+     * \return Index of the layer, or data_count() if there is no such layer
+     */
+    auto data_find(const std::string& quantity) const -> size_t;
+
+    /// Unpack and read every data layer asynchronously
+    /**
+     * Each layer is read as for data::read_unpack_async().  The data array must
+     * contain data_count() output buffers, any of which may be nullptr to skip
+     * the layer.  The future for a skipped layer is not valid.
+     *
+     * \return One future per data layer, in layer order
+     */
+    template <typename T>
+    auto read_unpack_async(T* const* data, T undetect, T nodata) const -> std::vector<std::future<void>>;
+
     /// Get the number of quality layers
     auto quality_count() const -> size_t                        { return size_quality_; }
     /// Open a quality layer
@@ -423,11 +946,12 @@ namespace odim_h5
           data::data_type type
         , size_t rank
         , const size_t* dims
-        , int compression = data::default_compression
+        , const data::compression_options& compression = data::default_compression
+        , const data::layout& storage = data::layout{}
         ) -> data;
 
   protected:
-    dataset(const handle& parent, size_t index, bool existing);
+    dataset(const attribute_store& parent, size_t index, bool existing);
 
   protected:
     size_t  size_data_;
@@ -446,6 +970,8 @@ namespace odim_h5
         create
       , read_only
       , read_write
+      , create_in_memory  ///< Build a new file entirely in memory (see image() and commit())
+      , create_live       ///< Build a new file in memory and publish snapshots of it to the path (see publish())
     };
 
     /// ODIM_H5 file scope object types
@@ -464,13 +990,123 @@ namespace odim_h5
       , graphical_image
     };
 
+    /// Options used when opening or creating a file
+    struct options
+    {
+      /// HDF5 file format versions which may be selected when creating objects
+      enum class format
+      {
+          earliest  ///< Use the earliest format able to store each object (HDF5 default)
+        , v18       ///< Use formats no older than those introduced in HDF5 1.8
+        , latest    ///< Use the latest formats (faster attribute and link storage)
+      };
+
+      options()
+        : attributes{load_policy::names}
+        , index_structure{false}
+        , chunk_cache_bytes{0}
+        , chunk_cache_slots{0}
+        , chunk_cache_preemption{-1.0}
+        , metadata_cache_size{0}
+        , alignment_threshold{0}
+        , alignment{0}
+        , meta_block_size{0}
+        , library_format{format::earliest}
+        , persist_free_space{false}
+      { }
+
+      /// Policy used to load the attributes of the file and every group opened through it
+      /**
+       * The snapshot policy reads every attribute value of a group in the same
+       * pass that enumerates the attribute names.  Getters are then served from
+       * memory and setters keep the cached values coherent.  Changes made through
+       * another handle to the same group are not visible to a snapshot.  The
+       * deferred policy postpones opening the what, where and how groups until
+       * the attributes of a group are first used, which suits groups that are
+       * opened only to read their data.
+       */
+      load_policy attributes;
+
+      /// Build an in-memory index of the file structure when it is opened
+      /**
+       * The whole file is visited once and the object address, storage type,
+       * shape and quantity of every dataset, data and quality group is recorded.
+       * Subsequent opens of those groups go directly to the object address and
+       * skip counting their members.  Groups appended after the file is opened
+       * are not indexed and are opened by name as usual.
+       */
+      bool        index_structure;
+
+      /// Size in bytes of the raw data chunk cache of each layer (zero for the HDF5 default)
+      size_t      chunk_cache_bytes;
+
+      /// Number of hash table slots in the raw data chunk cache (zero for the HDF5 default)
+      /**
+       * For best performance this should be a prime number around 100 times the
+       * number of chunks which fit in the cache.
+       */
+      size_t      chunk_cache_slots;
+
+      /// Chunk cache preemption policy between 0 and 1 (negative for the HDF5 default)
+      double      chunk_cache_preemption;
+
+      /// Initial size in bytes of the metadata cache (zero for the HDF5 default)
+      /**
+       * The maximum size of the adaptive metadata cache is raised to at least
+       * this value.
+       */
+      size_t      metadata_cache_size;
+
+      /// Objects at least this size are aligned in the file (used when alignment is set)
+      size_t      alignment_threshold;
+
+      /// Alignment in bytes of objects in the file (zero for no alignment)
+      size_t      alignment;
+
+      /// Minimum size in bytes of metadata block allocations (zero for the HDF5 default)
+      size_t      meta_block_size;
+
+      /// Earliest file format version used when creating objects
+      /**
+       * Files written using newer formats cannot be read by older versions of
+       * the HDF5 library.
+       */
+      format      library_format;
+
+      /// Track free space persistently in files created with these options
+      /**
+       * Space released when attributes are rewritten or removed is normally
+       * forgotten when the file is closed.  Persisting the free space manager
+       * allows files which are reopened using io_mode::read_write to reuse that
+       * space, so that sweeps can be appended and file level attributes updated
+       * repeatedly without the file growing on every rewrite.  Files created with
+       * this option require HDF5 1.10 or later to read.  It is ignored when built
+       * against older versions of HDF5, and has no effect when opening a file.
+       */
+      bool        persist_free_space;
+    };
+
   public:
     /// Open or create an ODIM_H5 file
     /**
      * \param path  Path of file to open
      * \param mode  Mode of open
+     * \param opts  Options used to open the file
+     */
+    file(const std::string& path, io_mode mode, const options& opts = options{});
+
+    /// Open an ODIM_H5 file image held in memory (read only)
+    /**
+     * The image is opened in place without copying where possible.  The HDF5
+     * tuning members of the options are not applied to file images.  The buffer
+     * is owned by the caller and must remain valid and unmodified until the file
+     * and every object opened from it have been destroyed.
+     *
+     * \param image Buffer containing the complete file image
+     * \param size  Size of the image in bytes
+     * \param opts  Options used to open the file
      */
-    file(const std::string& path, io_mode mode);
+    file(const void* image, size_t size, const options& opts = options{});
 
     /// Get the io_mode used to open the file
     auto mode() const noexcept -> io_mode                       { return mode_; }
@@ -478,6 +1114,46 @@ namespace odim_h5
     /// Ensure all write actions have been synced to disk
     auto flush() -> void;
 
+    /// Get a copy of the complete file image
+    /**
+     * The returned bytes form a valid HDF5 file which may be written out by the
+     * caller or opened again using the image constructor.
+     */
+    auto image() const -> std::vector<char>;
+
+    /// Write the complete file image to disk in a single write and atomically move it into place
+    /**
+     * The image is written to a temporary file alongside the destination which
+     * is then renamed over the destination, so readers never observe a partially
+     * written file.  This is intended for files created using
+     * io_mode::create_in_memory, but may be used with any open file.
+     *
+     * \param path  Destination path of the file
+     */
+    auto commit(const std::string& path) const -> void;
+
+    /// Publish the current state of a live file to its path
+    /**
+     * Files created using io_mode::create_live are built in memory and are
+     * written to their path only when published.  Each call atomically replaces
+     * the file on disk with a complete and consistent snapshot using commit(),
+     * so readers never observe a partially written volume.  A writer typically
+     * publishes after appending and writing each sweep.  Since the snapshot is
+     * moved into place by renaming, readers which already have the file open
+     * keep the snapshot they opened until they call refresh().  On Windows the
+     * rename fails while a reader holds the file open.
+     */
+    auto publish() const -> void;
+
+    /// Reopen the file from its path to pick up changes published by a writer
+    /**
+     * The dataset count, object type and file level attributes are reloaded
+     * (and the structure index rebuilt if enabled).  Objects opened before the
+     * refresh remain valid but continue to refer to the previous snapshot.
+     * Only files opened by path for reading may be refreshed.
+     */
+    auto refresh() -> void;
+
     /// Get the number of datasets in the file
     auto dataset_count() const -> size_t                        { return size_; }
     /// Open a dataset
@@ -526,10 +1202,16 @@ namespace odim_h5
     template <class T> auto dset_open_as(size_t i) const -> T;
     template <class T> auto dset_make_as() -> T;
 
+    file(handle::id_t hnd, io_mode mode, const options& opts);
+
+    auto build_structure() -> void;
+
   protected:
     io_mode     mode_;
     object_type type_;
     size_t      size_;
+    std::string path_;      // path used to open the file (empty for images)
+    options     opts_;      // options used to open the file
   };
 
   //----------------------------------------------------------------------------
@@ -607,7 +1289,7 @@ namespace odim_h5
     auto is_api_attribute(const std::string& name) const -> bool;
 
   protected:
-    scan(const handle& parent, size_t index, bool existing) : dataset(parent, index, existing) { }
+    scan(const attribute_store& parent, size_t index, bool existing) : dataset(parent, index, existing) { }
     friend class file;
   };
 
@@ -616,7 +1298,9 @@ namespace odim_h5
   {
   public:
     /// Open or create a polar volume ODIM_H5 file
-    polar_volume(const std::string& path, io_mode mode);
+    polar_volume(const std::string& path, io_mode mode, const options& opts = options{});
+    /// Open a polar volume ODIM_H5 file image held in memory (read only)
+    polar_volume(const void* image, size_t size, const options& opts = options{});
     /// Cast an open ODIM_H5 file to a polar volume handle
     polar_volume(file f);
 
@@ -625,6 +1309,10 @@ namespace odim_h5
     /// Open a scan
     auto scan_open(size_t i) const -> scan                      { return dset_open_as<scan>(i); }
     /// Append a new scan
+    /**
+     * When the volume was opened using io_mode::read_write the new scan follows
+     * the scans already in the file.
+     */
     auto scan_append() -> scan                                  { return dset_make_as<scan>(); }
 
     /// Get the longitude of the antenna
@@ -682,7 +1370,7 @@ namespace odim_h5
     auto is_api_attribute(const std::string& name) const -> bool;
 
   protected:
-    profile(const handle& parent, size_t index, bool existing) : dataset(parent, index, existing) { }
+    profile(const attribute_store& parent, size_t index, bool existing) : dataset(parent, index, existing) { }
     friend class file;
   };
 
@@ -691,7 +1379,9 @@ namespace odim_h5
   {
   public:
     /// Open or create a polar volume ODIM_H5 file
-    vertical_profile(const std::string& path, io_mode mode);
+    vertical_profile(const std::string& path, io_mode mode, const options& opts = options{});
+    /// Open a vertical profile ODIM_H5 file image held in memory (read only)
+    vertical_profile(const void* image, size_t size, const options& opts = options{});
     /// Cast an open ODIM_H5 file to a polar volume handle
     vertical_profile(file f);
 
@@ -740,6 +1430,216 @@ namespace odim_h5
     auto is_api_attribute(const std::string& name) const -> bool;
   };
 
+  //----------------------------------------------------------------------------
+  // cataloguing:
+
+  /// Summary of the metadata needed to catalogue a file
+  struct file_summary
+  {
+    /// Summary of a single dataset (sweep)
+    struct dataset_summary
+    {
+      double      elangle;      ///< Elevation angle (NaN if not present)
+      std::string start_date;   ///< Start date string (empty if not present)
+      std::string start_time;   ///< Start time string (empty if not present)
+    };
+
+    file::object_type             object;   ///< File object type
+    std::string                   date;     ///< Product date string (empty if not present)
+    std::string                   time;     ///< Product time string (empty if not present)
+    std::string                   source;   ///< Product source string (empty if not present)
+    std::vector<dataset_summary>  datasets; ///< One entry per datasetX group
+  };
+
+  /// Read the summary metadata of a file
+  /**
+   * Only root what/object, what/date, what/time, what/source and the elangle,
+   * startdate and starttime attributes of each dataset are read.  Each value is
+   * read directly by path without opening the intermediate groups, enumerating
+   * attributes or building the objects used by the file constructor.  Missing
+   * attributes are left at their empty values rather than reported as errors.
+   *
+   * \param path  Path of file to summarise
+   */
+  auto read_summary(const std::string& path) -> file_summary;
+
+  /// Persistent catalogue of the ODIM_H5 files below a directory
+  /**
+   * The catalogue records, for every file, its source, object type and nominal
+   * time, and for every data layer of every dataset the elevation angle, start
+   * time, quantity, storage type, shape and the location of each stored chunk.
+   * It is stored as a single flat binary file which is memory mapped by readers
+   * so that queries run without opening any HDF5 file or parsing the catalogue.
+   * The catalogue is written in native byte order and is rejected by machines
+   * using a different byte order.
+   */
+  class catalogue
+  {
+  public:
+    /// Location of a stored chunk within its file
+    typedef data::extent chunk;
+
+    /// Layer matched by a query (strings and arrays refer to the mapped catalogue)
+    struct match
+    {
+      const char*       path;         ///< Path of the file
+      const char*       source;       ///< Source string of the file
+      file::object_type object;       ///< Object type of the file
+      time_t            time;         ///< Nominal time of the file (0 if unknown)
+      size_t            dataset;      ///< Index of the dataset within the file
+      double            elangle;      ///< Elevation angle of the dataset (NaN if unknown)
+      time_t            start;        ///< Start time of the dataset (0 if unknown)
+      size_t            layer;        ///< Index of the data layer within the dataset
+      const char*       quantity;     ///< Quantity of the layer
+      data::data_type   type;         ///< Storage type of the layer
+      size_t            rank;         ///< Number of dimensions of the layer
+      const uint64_t*   dims;         ///< Size of each dimension of the layer
+      size_t            chunk_count;  ///< Number of stored chunks
+      const chunk*      chunks;       ///< Location of each stored chunk
+    };
+
+    /// Selection criteria used by find(), the defaults match every layer
+    struct query
+    {
+      query()
+        : from{std::numeric_limits<time_t>::min()}
+        , to{std::numeric_limits<time_t>::max()}
+        , min_elangle{-std::numeric_limits<double>::infinity()}
+        , max_elangle{std::numeric_limits<double>::infinity()}
+      { }
+
+      /// Source string, or one of its comma separated fields such as "NOD:abcde" (empty for any)
+      std::string source;
+      /// Quantity (empty for any)
+      std::string quantity;
+      /// Earliest nominal file time (inclusive)
+      time_t      from;
+      /// Latest nominal file time (exclusive)
+      time_t      to;
+      /// Minimum elevation angle (inclusive, datasets with no angle only match the default)
+      double      min_elangle;
+      /// Maximum elevation angle (exclusive, datasets with no angle only match the default)
+      double      max_elangle;
+    };
+
+    /// Counts reported by update()
+    struct update_stats
+    {
+      size_t  files;    ///< Number of files in the catalogue
+      size_t  scanned;  ///< Number of new or modified files which were opened
+      size_t  failed;   ///< Number of files which could not be read and were left out
+    };
+
+  public:
+    /// Build or incrementally update the catalogue of a directory tree
+    /**
+     * Files ending in .h5, .hdf5 or .hdf are found recursively below root
+     * (symbolic links are not followed).  Entries for files whose size and
+     * modification time are unchanged are copied from the existing catalogue,
+     * other files are opened and scanned.  Entries for files which no longer
+     * exist are dropped.  The new catalogue atomically replaces the old one.
+     *
+     * \param root  Directory to catalogue
+     * \param path  Path of the catalogue file
+     */
+    static auto update(const std::string& root, const std::string& path) -> update_stats;
+
+    /// Open a catalogue file
+    catalogue(const std::string& path);
+
+    catalogue(const catalogue& rhs) = delete;
+    catalogue(catalogue&& rhs) noexcept;
+    auto operator=(const catalogue& rhs) -> catalogue& = delete;
+    auto operator=(catalogue&& rhs) noexcept -> catalogue&;
+    ~catalogue();
+
+    /// Get the number of files in the catalogue
+    auto file_count() const -> size_t;
+    /// Get the number of layers in the catalogue
+    auto layer_count() const -> size_t;
+
+    /// Call a function for every layer which matches a query
+    /**
+     * \return Number of matching layers
+     */
+    auto find(const query& q, const std::function<void(const match&)>& fn) const -> size_t;
+
+  private:
+    void*       base_;
+    size_t      length_;
+  };
+
+  //----------------------------------------------------------------------------
+  // batch loading:
+
+  /// Selection of the layers loaded from each file by load_batch()
+  struct batch_selection
+  {
+    batch_selection() : memory_budget{256 * 1024 * 1024} { }
+
+    /// Quantities to load (empty to load every data layer)
+    std::vector<std::string>  quantities;
+
+    /// Indexes of the datasets (sweeps) to load from each file (empty to load every dataset)
+    std::vector<size_t>       datasets;
+
+    /// Maximum number of bytes of unpacked values held before they are delivered
+    /**
+     * Once the budget is reached no further layers are read until the oldest
+     * pending dataset has been delivered.  A single dataset larger than the
+     * budget is still loaded.
+     */
+    size_t                    memory_budget;
+
+    /// Options used to open each file
+    file::options             options;
+  };
+
+  /// Unpacked data layer delivered by load_batch()
+  template <typename T>
+  struct batch_layer
+  {
+    size_t              index;      ///< Index of the layer within the dataset
+    std::string         quantity;   ///< Quantity identifier
+    std::vector<size_t> dims;       ///< Size of each dimension
+    std::vector<T>      values;     ///< Unpacked values
+  };
+
+  /// Dataset (sweep) delivered by load_batch()
+  template <typename T>
+  struct batch_dataset
+  {
+    size_t                      file;     ///< Index of the file in the path list
+    size_t                      index;    ///< Index of the dataset within the file
+    std::vector<batch_layer<T>> layers;   ///< Selected layers in layer order
+  };
+
+  /// Load and unpack selected layers from many files, delivering each dataset in order
+  /**
+   * Files are opened and raw chunks fetched on the calling thread, which is the
+   * only thread to call into the HDF5 library.  Decompression and unpacking is
+   * performed on the library worker pool without holding up the next fetch, so
+   * reading of later files overlaps the decoding of earlier ones.  Datasets are
+   * passed to the consumer on the calling thread in file and dataset order as
+   * soon as every selected layer has been decoded.  Dataset indexes beyond the
+   * end of a file and datasets with no selected layers are skipped.  The first
+   * error encountered is thrown once all outstanding work has finished.
+   *
+   * \param paths     Files to load
+   * \param selection Layers to load and resource limits
+   * \param undetect  Value used for undetect points
+   * \param nodata    Value used for nodata points
+   * \param consumer  Called with each loaded dataset, which it may move from
+   */
+  template <typename T>
+  auto load_batch(
+        const std::vector<std::string>& paths
+      , const batch_selection& selection
+      , T undetect
+      , T nodata
+      , const std::function<void(batch_dataset<T>&)>& consumer
+      ) -> void;
+
   /* efficient use of library:
    *
    * // best...